@@ -20,7 +20,11 @@ also available at <https://www.gnu.org/licenses/>
 //
 
 #include <stdlib.h>
+#include <limits.h>
 #include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
 #include "SRmodel.h"
 
 using namespace std;
@@ -28,15 +32,362 @@ using namespace std;
 //One global instance of "model";
 SRmodel model;
 
+static bool readElemRange(const char* tok, int& first, int& last)
+{
+	//read an element uid or uid range of a breakout elements option
+	//input:
+		//tok = "N" or "N-M"
+	//output:
+		//first, last = first and last uid of the range, both N for a single uid
+	//return:
+		//false unless the whole token is a positive uid or a range of them with N <= M
+	char* e;
+	long n = strtol(tok, &e, 10);
+	if (e == tok || n < 1 || n > INT_MAX)
+		return false;
+	long m = n;
+	if (*e == '-')
+	{
+		const char* s = e + 1;
+		if (*s < '0' || *s > '9')
+			return false;
+		m = strtol(s, &e, 10);
+		if (m < n || m > INT_MAX)
+			return false;
+	}
+	if (*e != '\0')
+		return false;
+	first = (int) n;
+	last = (int) m;
+	return true;
+}
+
+static void readBreakoutOption(SRstring& line)
+{
+	//read a breakout option line of translateCmd.txt
+	//spec:
+		//breakout box xmin ymin zmin xmax ymax zmax [rings n]
+		//breakout sphere x y z radius [rings n]
+		//breakout elements uid uid1-uid2 ... [rings n]
+	SRbreakoutRegion& br = model.breakout;
+	line.Token(); //skip "breakout"
+	const char* tok = line.Token();
+	if (tok == NULL)
+		return;
+	SRstring type(tok);
+	bool ok = true;
+	if (type == "box")
+	{
+		br.type = boxBreakout;
+		for (int i = 0; i < 3; i++)
+			ok = ok && line.TokRead(br.p1.d[i]);
+		for (int i = 0; i < 3; i++)
+			ok = ok && line.TokRead(br.p2.d[i]);
+	}
+	else if (type == "sphere")
+	{
+		br.type = sphereBreakout;
+		for (int i = 0; i < 3; i++)
+			ok = ok && line.TokRead(br.p1.d[i]);
+		ok = ok && line.TokRead(br.radius);
+	}
+	else if (type == "elements")
+		br.type = elemBreakout;
+	else
+		ok = false;
+	while (ok)
+	{
+		tok = line.Token();
+		if (tok == NULL)
+			break;
+		SRstring field(tok);
+		int first, last;
+		if (field == "rings")
+			ok = line.TokRead(br.rings);
+		else if (br.type == elemBreakout && readElemRange(tok, first, last))
+			br.elemUids.push_back(make_pair(first, last));
+		else
+		{
+			SCREENPRINT("translateCmd breakout option: bad field %s\n", field.getStr());
+			ok = false;
+		}
+	}
+	if (br.type == elemBreakout && br.elemUids.empty())
+		ok = false;
+	if (ok && br.type == elemBreakout)
+	{
+		//sort the ranges and merge the ones that overlap or touch, so they are disjoint for the
+		//binary search in SRinput::selectBreakoutElements:
+		sort(br.elemUids.begin(), br.elemUids.end());
+		size_t nmerged = 0;
+		for (size_t i = 1; i < br.elemUids.size(); i++)
+		{
+			pair <int, int>& prev = br.elemUids[nmerged];
+			if ((long long) br.elemUids[i].first <= (long long) prev.second + 1)
+				prev.second = max(prev.second, br.elemUids[i].second);
+			else
+				br.elemUids[++nmerged] = br.elemUids[i];
+		}
+		br.elemUids.resize(nmerged + 1);
+	}
+	if (!ok)
+	{
+		SCREENPRINT("translateCmd breakout option not understood: %s\n", line.getStr());
+		ERROREXIT;
+	}
+}
+
+static void readTranslateOption(SRstring& line)
+{
+	//read an option line of translateCmd.txt
+	//options:
+		//renumber = order nodes and elements in the .msh file for locality
+		//merge [tol] = merge nodes closer than tol times the model size, default RELSMALL
+		//breakout ... = keep only a region of the model, see readBreakoutOption
+		//index = write a card index next to the bdf file, and use it to skip the counting pass when the
+		//        same file is translated again
+		//onerror fail|continue = stop or go on when a card can't be translated. the errors are written
+		//                        to xlate_errors.txt either way
+		//loglevel debug|info|warning|error = lowest level of messages written to the log file, default info
+	if (line.CompareUseLength("renumber"))
+		model.renumberOutput = true;
+	else if (line.CompareUseLength("index"))
+		model.useBdfIndex = true;
+	else if (line.CompareUseLength("onerror"))
+	{
+		//onerror fail (default) or onerror continue, see SRinput::checkCardErrors
+		SRstring policy;
+		policy.Copy(line.getStr() + 7);
+		policy.TrimWhiteSpace();
+		model.continueOnCardError = policy.CompareUseLength("continue");
+	}
+	else if (line.CompareUseLength("loglevel"))
+	{
+		SRstring level;
+		level.Copy(line.getStr() + 8);
+		level.TrimWhiteSpace();
+		if (level.CompareUseLength("debug"))
+			model.logLevel = logDebug;
+		else if (level.CompareUseLength("info"))
+			model.logLevel = logInfo;
+		else if (level.CompareUseLength("warning"))
+			model.logLevel = logWarning;
+		else if (level.CompareUseLength("error"))
+			model.logLevel = logError;
+	}
+	else if (line.CompareUseLength("merge"))
+	{
+		model.mergeTol = RELSMALL;
+		double tol;
+		if (SSCANF(line.getStr() + 5, "%lg", &tol) == 1 && tol > 0.0)
+			model.mergeTol = tol;
+	}
+	else if (line.CompareUseLength("breakout"))
+		readBreakoutOption(line);
+}
+
+#define GOLDENTOLERANCE 0.25 //default fraction the throughput may fall below the golden throughput
+
+static bool readWholeFile(const char* name, string& contents)
+{
+	//read a file into memory unchanged
+	//input:
+		//name = file name
+	//output:
+		//contents = the bytes of the file
+	//return:
+		//false if the file could not be opened, else true
+	FILE* f = NULL;
+	FOPEN(f, name, "rb");
+	if (f == NULL)
+		return false;
+	contents.clear();
+	char buf[65536];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		contents.append(buf, n);
+	fclose(f);
+	return true;
+}
+
+static bool writeWholeFile(const char* name, string& contents)
+{
+	//write a file from memory unchanged, see readWholeFile
+	FILE* f = NULL;
+	FOPEN(f, name, "wb");
+	if (f == NULL)
+		return false;
+	bool ok = (fwrite(contents.data(), 1, contents.size(), f) == contents.size());
+	if (fclose(f) != 0)
+		ok = false;
+	return ok;
+}
+
+static bool checkGoldenFile(SRstring& name, SRstring& goldenDir, bool update)
+{
+	//compare an output file with the file of the same name in the golden directory, or replace the golden file
+	//input:
+		//name = output file
+		//goldenDir = golden directory
+		//update = true to copy the output file to the golden directory instead of comparing
+	//return:
+		//false if the files differ or one of them is missing, else true
+	//note:
+		//an output that is missing and has no golden file, e.g. the .srr of a model without a
+		//displacement file, matches. an empty output is never a golden file, and never matches
+		//a golden file that is not empty
+	const char* tail = name.LastChar(slashChar, true);
+	if (tail == NULL)
+		tail = name.getStr();
+	SRstring goldenName = goldenDir;
+	goldenName += slashStr;
+	goldenName += tail;
+	string out, golden;
+	bool haveOut = readWholeFile(name.getStr(), out);
+	if (update)
+	{
+		if (haveOut && out.empty())
+		{
+			SCREENPRINT(" golden check: %s is empty, not copied to golden files\n", tail);
+			LOGPRINT(" golden check: %s is empty, not copied to golden files", tail);
+			return false;
+		}
+		if (haveOut)
+			return writeWholeFile(goldenName.getStr(), out);
+		SRfile::Delete(goldenName.getStr());
+		return true;
+	}
+	bool haveGolden = readWholeFile(goldenName.getStr(), golden);
+	if (!haveOut && !haveGolden)
+		return true;
+	if (haveOut != haveGolden)
+	{
+		SCREENPRINT(" golden check: %s %s\n", tail, haveOut ? "has no golden file" : "was not written");
+		LOGPRINT(" golden check: %s %s", tail, haveOut ? "has no golden file" : "was not written");
+		return false;
+	}
+	if (out.empty() && !golden.empty())
+	{
+		SCREENPRINT(" golden check: %s is empty (golden %lld bytes)\n", tail, (long long) golden.size());
+		LOGPRINT(" golden check: %s is empty (golden %lld bytes)", tail, (long long) golden.size());
+		return false;
+	}
+	if (out == golden)
+		return true;
+	size_t pos = 0;
+	while (pos < out.size() && pos < golden.size() && out[pos] == golden[pos])
+		pos++;
+	long long line = 1;
+	for (size_t i = 0; i < pos; i++)
+	{
+		if (out[i] == '\n')
+			line++;
+	}
+	SCREENPRINT(" golden check: %s differs at line %lld (%lld bytes, golden %lld)\n", tail, line,
+		(long long) out.size(), (long long) golden.size());
+	LOGPRINT(" golden check: %s differs at line %lld (%lld bytes, golden %lld)", tail, line,
+		(long long) out.size(), (long long) golden.size());
+	return false;
+}
+
+static bool checkGolden(SRstring& goldenDir, bool update, double seconds)
+{
+	//compare the .msh, .srr, subcase .loads files and xlate_status.txt of a translation with golden copies,
+	//and check that the throughput has not fallen too far below the golden throughput
+	//input:
+		//goldenDir = directory with the golden files
+		//update = true to replace the golden files with this translation's instead of comparing
+		//seconds = time taken by the translation
+	//return:
+		//false if any output differs or the throughput is too low, else true
+	//note:
+		//the golden throughput is in goldenDir/throughput.txt: "<MB/s> [tolerance]". the check fails if the
+		//throughput is below (1 - tolerance) times the golden throughput; the default tolerance is GOLDENTOLERANCE.
+		//a single translation of a small deck is a noisy measurement, so use a large deck or a loose tolerance
+	double mbps = (seconds > 0.0) ? model.input.bdfSize / 1.0e6 / seconds : 0.0;
+	SRstring statName = model.wkdir;
+	statName += "xlate_status.txt";
+	bool ok = checkGoldenFile(model.mshFile.filename, goldenDir, update);
+	ok = checkGoldenFile(model.srrFile.filename, goldenDir, update) && ok;
+	if (model.isMultiSubcase())
+	{
+		for (SRindex i = 0; i < model.subcases.GetNum(); i++)
+		{
+			SRstring loadsName;
+			model.output.SubcaseFileName(model.subcases.GetPointer(i), loadsName);
+			ok = checkGoldenFile(loadsName, goldenDir, update) && ok;
+		}
+	}
+	ok = checkGoldenFile(statName, goldenDir, update) && ok;
+
+	SRstring tpName = goldenDir;
+	tpName += slashStr;
+	tpName += "throughput.txt";
+	SRfile tpFile;
+	if (update)
+	{
+		tpFile.Open(tpName, SRoutputMode);
+		tpFile.PrintLine("%.2f %.2f", mbps, GOLDENTOLERANCE);
+		tpFile.Close();
+		SCREENPRINT(" golden files updated in %s, throughput %.2f MB/s\n", goldenDir.getStr(), mbps);
+		LOGPRINT(" golden files updated in %s, throughput %.2f MB/s", goldenDir.getStr(), mbps);
+		return ok;
+	}
+	double goldenMbps = 0.0, tolerance = GOLDENTOLERANCE;
+	SRstring line;
+	if (tpFile.Open(tpName, SRinputMode) && tpFile.GetLine(line))
+	{
+		int n = SSCANF(line.getStr(), "%lg %lg", &goldenMbps, &tolerance);
+		if (n < 2)
+			tolerance = GOLDENTOLERANCE;
+	}
+	tpFile.Close();
+	if (goldenMbps > 0.0 && mbps < (1.0 - tolerance) * goldenMbps)
+	{
+		SCREENPRINT(" golden check: throughput %.2f MB/s is below %.2f MB/s (golden %.2f, tolerance %.2f)\n",
+			mbps, (1.0 - tolerance) * goldenMbps, goldenMbps, tolerance);
+		LOGPRINT(" golden check: throughput %.2f MB/s is below %.2f MB/s (golden %.2f, tolerance %.2f)",
+			mbps, (1.0 - tolerance) * goldenMbps, goldenMbps, tolerance);
+		ok = false;
+	}
+	if (ok)
+	{
+		SCREENPRINT(" golden check passed, throughput %.2f MB/s\n", mbps);
+		LOGPRINT(" golden check passed, throughput %.2f MB/s", mbps);
+	}
+	return ok;
+}
+
 int main(int argc, char *argv[])
 {
 	SRfile ft;
 	SRfile modelF;
 	SRstring line, nametail, infoldername, outfoldername, inname, outname;
 
-	if (argc > 1)
+	//command line: bdfTranslate [--stats] [--golden dir | --golden-update dir] [wkdir]
+		//--stats = write per card type counts and times to wkdir/xlate_stats.txt, see SRstats
+		//--golden dir = compare the output with the golden files in dir and exit with 2 if it differs
+		//               or the throughput is too low, see checkGolden
+		//--golden-update dir = replace the golden files in dir with the output of this translation
+	const char* wkdirArg = NULL;
+	SRstring goldenDir;
+	bool goldenUpdate = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (STRCMP(argv[i], "--stats") == 0)
+			model.input.stats.on = true;
+		else if ((STRCMP(argv[i], "--golden") == 0 || STRCMP(argv[i], "--golden-update") == 0) && i + 1 < argc)
+		{
+			goldenUpdate = (STRCMP(argv[i], "--golden-update") == 0);
+			goldenDir = argv[i + 1];
+			i++;
+		}
+		else if (wkdirArg == NULL)
+			wkdirArg = argv[i];
+	}
+	if (wkdirArg != NULL)
 	{
-		model.wkdir.Copy(argv[1]);
+		model.wkdir.Copy(wkdirArg);
 	}
 	else
 	{
@@ -76,7 +427,12 @@ int main(int argc, char *argv[])
 			model.cropModelWithDispNodes = true;
 			model.nodeDispFile.SetFileName(dispFile);
 		}
+		else
+			readTranslateOption(dispFile);
 	}
+	//remaining lines are options, one per line:
+	while (modelF.GetLine(line))
+		readTranslateOption(line);
 
 	outfoldername.Right(slashChar, model.SrFileNameTail);
 	if (!model.inpFile.Existcheck(bdfFileName.getStr()))
@@ -108,6 +464,7 @@ int main(int argc, char *argv[])
 	line += "out.txt";
 	model.outputFile.SetFileName(line);
 	model.outputFile.Delete();
+	SRfile::StartLogging();
 
 
 	bdfFileName.Copy(outfoldername);
@@ -127,8 +484,20 @@ int main(int argc, char *argv[])
 
 	SCREENPRINT(" Translating %s\n", model.fileNameTail.getStr());
 	OUTPRINT(" Translating %s\n", model.fileNameTail.getStr());
+	SRstring errName = model.wkdir;
+	errName += "xlate_errors.txt";
+	SRfile::Delete(errName.getStr());
+	chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
 	if (!model.input.Translate())
-		exit(0);
+	{
+		model.input.writeCardErrors();
+		model.input.stats.Write();
+		SRfile::StopLogging();
+		return 1;
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+	model.input.writeCardErrors();
+	model.input.stats.Write();
 
 	model.statFile.Open(SRoutputMode);
 	model.statFile.PrintLine("translation successful model %s", model.fileNameTail.getStr());
@@ -140,13 +509,25 @@ int main(int argc, char *argv[])
 		model.statFile.PrintLine("Partial Displacement File");
 	if (model.isNx)
 		model.statFile.PrintLine("NxNastran Model");
+	if (!model.input.cardErrors.empty())
+		model.statFile.PrintLine("%d cards skipped, see xlate_errors.txt", (int) model.input.cardErrors.size());
 	model.statFile.Close();
+	//the golden check needs the subcases, so it is done before the model is cleaned up:
+	int ret = 0;
+	if (goldenDir.getLength() > 0)
+	{
+		if (goldenUpdate)
+			SRfile::CreateDir(goldenDir.getStr());
+		if (!checkGolden(goldenDir, goldenUpdate, seconds))
+			ret = 2;
+	}
 	model.CleanUp();
 
 	SCREENPRINT("SuccessFul Completion\n");
 	OUTPRINT("SuccessFul Completion\n");
+	SRfile::StopLogging();
 	model.outputFile.Delete();
 
-	return 0;
+	return ret;
 }
 
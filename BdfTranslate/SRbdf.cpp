@@ -22,7 +22,10 @@ also available at <https://www.gnu.org/licenses/>
 //////////////////////////////////////////////////////////////////////
 
 #include <search.h>
+#include <algorithm>
+#include <stdarg.h>
 #include "SRmodel.h"
+#include "SRparallel.h"
 #include <chrono>
 
 #ifdef _DEBUG
@@ -36,22 +39,39 @@ bool SRinput::BdfInput()
 {
 
 	//faster version- minimizes passes through bdf file
-	//1 pass to count, 1 pass to read everything. do not crop inside e.g. inputelement.
-	//make an int array for unsup and shell. int unsupdnodes. store uid and type
-	//after read everything, crop --> pack nodes
-	//then process elements and pack, setnodeelementowners.
+	//1 pass to count, 1 pass to read everything.
+	//with the index option, the counting pass is replaced by a card index written the first time
+	//a bdf file is translated, see readBdfIndex.
+	//when cropping with displacement nodes, the crop is done while streaming:
+	//the disp node ids are read first, the counting pass marks the elements that touch them
+	//and their nodes, and the 2nd pass only creates those nodes and elements.
 	//then process constraints and forces and pack.
 
-	anyCoordsReferenceGrids = false;
+
+	if (model.cropModelWithDispNodes)
+		readDispNodes();
 
 	//count entities: nodes, elements, constraints, forces:
 	//input coords, mats, and elprops because they need to be sorted before input elements and input nodes
 	nnode = nelem = 0;
-	int nforce = 0, nvol = 0, ntherm = 0, ncon = 0, nspcd = 0, numunsup = 0;
+	SRindex nforce = 0, nvol = 0, ntherm = 0, ncon = 0, nspcd = 0, numunsup = 0;
+	SRindex nelemKept = 0;
 	SRstring tok;
 	SRstring filename, line, basename, tail;
 
-	TopToBulk();
+	SRbdfIndex index;
+	bool indexed = false; //counting pass replaced by the card index
+	bool indexing = false; //card index built in the counting pass
+	if (model.useBdfIndex && !model.cropModelWithDispNodes)
+	{
+		indexed = readBdfIndex(index);
+		indexing = !indexed;
+	}
+
+	if (!TopToBulk())
+		return false;
+	if (!indexed)
+		model.inpFile.StartBdfPrefetch();
 
 	bool isComment = false;
 	bool isMat = false;
@@ -59,11 +79,29 @@ bool SRinput::BdfInput()
 	SRstring matname;
 
 	//first pass through bdf file. read mats, elprops, and coordinates, count everything else.
-	int linesRead = 0;
+	SRindex linesRead = 0;
+	SRindex setupCard = 0;
 	while (1)
 	{
-		bool ret = model.inpFile.GetBdfLine(line, isComment, isMat, tok);
-		linesRead++;
+		bool ret;
+		if (indexed)
+		{
+			//only read the cards the counting pass needs:
+			ret = (setupCard < (SRindex) index.setupCards.size());
+			if (ret)
+			{
+				SRbdfIndexCard& card = index.setupCards[setupCard];
+				setupCard++;
+				model.inpFile.MapSeek(card.pos, card.line);
+				ret = model.inpFile.GetBdfLine(line, isComment, isMat, tok);
+				linesRead = card.seq;
+			}
+		}
+		else
+		{
+			ret = model.inpFile.GetBdfLine(line, isComment, isMat, tok);
+			linesRead++;
+		}
 		if (isComment && linesRead < 10)
 		{
 			SRstring rtStr;
@@ -82,14 +120,30 @@ bool SRinput::BdfInput()
 		}
 		if (!ret)
 			break;
+		if (indexing)
+			indexBdfCard(index, line, isComment, isMat, linesRead);
 
 		if (isComment)
 			continue;
 		else if (line.CompareUseLength("GRID"))
+		{
+			if (model.cropModelWithDispNodes)
+			{
+				line.BdfToken();//skip "GRID"
+				int uid;
+				line.BdfRead(uid);
+				deckNodeUids.Set(uid);
+			}
 			nnode++;
+		}
 		else if (line.CompareUseLength("CHEXA") || line.CompareUseLength("CPENTA") || line.CompareUseLength("CTETRA"))
 		{
-			if (nelem == 0)
+			if (model.cropModelWithDispNodes)
+			{
+				if (cropCheckElement(line, nelem == 0))
+					nelemKept++;
+			}
+			else if (nelem == 0)
 			{
 				//check for linear mesh:
 				tok = line.BdfToken();//skip element label field (e.g chexa)
@@ -113,11 +167,25 @@ bool SRinput::BdfInput()
 		else if (line.CompareUseLength("PLOAD4"))
 			nforce++;
 		else if (line.CompareUseLength("GRAV") || line.CompareUseLength("RFORCE"))
+		{
+			if (model.cropModelWithDispNodes && line.CompareUseLength("RFORCE"))
+			{
+				//the origin grid is needed while reading the RFORCE card in the 2nd pass:
+				int lsid, cuid, grid;
+				line.BdfToken();//skip "RFORCE"
+				line.BdfRead(lsid);
+				line.BdfRead(cuid);
+				if (line.BdfRead(grid))
+					cropNodeUids.Set(grid);
+			}
 			nvol++;
+		}
 		else if (line.CompareUseLength("TEMP"))
 			ntherm++;
 		else if (line.CompareUseLength("SPCD"))
 			nspcd++;
+		else if (line.CompareUseLength("SPCADD") || isLoadCombination(line))
+			InputSetCombination(line);
 		else if (line.CompareUseLength("SPC1") || line.CompareUseLength("SPC"))
 			ncon++;
 		else if (line.CompareUseLength("CORD"))
@@ -133,33 +201,100 @@ bool SRinput::BdfInput()
 			line.CompareUseLength("MPC") || line.CompareUseLength("SUPORT") || line.CompareUseLength("BSURFS"))
 
 		{
+			if (model.cropModelWithDispNodes && line.CompareUseLength("BSURFS"))
+			{
+				//elements referenced by BSURFS have to be found when the BSURFS are processed,
+				//even if they are cropped. conservatively mark every id on the card:
+				line.BdfToken();//skip "BSURFS"
+				line.BdfToken();//skip bsurf id
+				while (1)
+				{
+					const char* s = line.BdfToken(false);
+					if (s == NULL)
+						break;
+					int id;
+					if (SSCANF(s, "%d", &id) > 0)
+						bsurfIds.Set(id);
+				}
+			}
 			numunsup++;
 		}
 	}
-
-	SortOtherEntities();
-
-	model.nodes.Allocate(nnode);
+	model.inpFile.StopBdfPrefetch();
+
+	if (indexed)
+	{
+		nnode = index.nnode;
+		nelem = index.nelem;
+		nforce = index.nforce;
+		nvol = index.nvol;
+		ntherm = index.ntherm;
+		nspcd = index.nspcd;
+		ncon = index.ncon;
+		numunsup = index.numunsup;
+		model.linearMesh = index.linearMesh;
+		if (index.isNx)
+			model.isNx = true;
+	}
+	else if (indexing)
+	{
+		index.nnode = nnode;
+		index.nelem = nelem;
+		index.nforce = nforce;
+		index.nvol = nvol;
+		index.ntherm = ntherm;
+		index.nspcd = nspcd;
+		index.ncon = ncon;
+		index.numunsup = numunsup;
+		index.linearMesh = model.linearMesh;
+		index.isNx = model.isNx;
+		writeBdfIndex(index);
+	}
+
+	if (!SortOtherEntities())
+		return false;
+
+	SRindex nnodeAlloc = nnode;
+	SRindex nelemAlloc = nelem;
+	if (model.cropModelWithDispNodes)
+	{
+		//only the nodes of kept elements are created. nnode stays the number of GRIDs in the deck:
+		nnodeAlloc = cropNodeUids.CountCommon(deckNodeUids);
+		nelemAlloc = nelemKept + bsurfIds.Count();
+		if (nelemAlloc > nelem)
+			nelemAlloc = nelem;
+	}
+	model.nodes.Allocate(nnodeAlloc);
 	//note: can't be sure there are not constraints on the grid cards, so conservatively add nnode to ncon:
-	ncon += nnode;
+	ncon += nnodeAlloc;
 	model.constraints.Allocate(ncon);
 	model.enfds.Allocate(nspcd);
-	model.elements.Allocate(nelem);
+	model.elements.Allocate(nelemAlloc);
 	model.forces.Allocate(nforce);
 	model.volumeForces.Allocate(nvol);
 	if (ntherm != 0)
 		model.thermalForce = new SRthermalForce;
 	model.unsups.Allocate(numunsup);
+	stats.Phase(indexed ? "setup cards from index" : "counting pass");
 
 	//2nd pass through bdf file. read everything else.
 
-	TopToBulk();
+	if (!TopToBulk())
+		return false;
+	model.inpFile.StartBdfPrefetch();
 
-	int nline = 0;
-	int numFaces = 0;
+	SRindex nline = 0;
+	SRindex numFaces = 0;
+	SRcardStat* st = NULL;
 	while (1)
 	{
-		if (!model.inpFile.GetBdfLine(line, isComment, matNameWasRead, matname))
+		bool ret = model.inpFile.GetBdfLine(line, isComment, matNameWasRead, matname);
+		if (stats.on)
+		{
+			stats.EndCard(st);
+			st = stats.StartCard(ret ? &line : NULL, model.inpFile.bdfCardPos);
+		}
+		if (!ret)
 			break;
 		if (isComment)
 			continue;
@@ -170,9 +305,9 @@ bool SRinput::BdfInput()
 		else if (line.CompareUseLength("FORCE") || line.CompareUseLength("PLOAD4") ||
 			line.CompareUseLength("FORCE1") || line.CompareUseLength("FORCE2"))
 			InputForce(line);
-		if (line.CompareUseLength("SPCD"))
+		else if (line.CompareUseLength("SPCD"))
 			InputEnfd(line);
-		else if (line.CompareUseLength("SPC1") || line.CompareUseLength("SPC"))
+		else if (line.CompareUseLength("SPC1") || (line.CompareUseLength("SPC") && !line.CompareUseLength("SPCADD")))
 			InputConstraint(line);
 		else if (line.CompareUseLength("GRAV") || line.CompareUseLength("RFORCE"))
 			InputVolumeForce(line);
@@ -187,119 +322,115 @@ bool SRinput::BdfInput()
 		{
 			inputUnsupported(line);
 			model.anyUnsupportedElement = true;
+			if (st != NULL)
+				st->dropped++;
 		}
+		else if (st != NULL && !line.CompareUseLength("CORD") && !line.CompareUseLength("MAT1") &&
+			!line.CompareUseLength("PSOLID") && !line.CompareUseLength("SPCADD") && !isLoadCombination(line))
+			st->dropped++; //not translated
 		nline++;
 	}
+	model.inpFile.StopBdfPrefetch();
+	stats.Phase("reading pass");
+	if (!checkCardErrors())
+		return false;
+
+	//coordinate systems may be defined by grids, so they are resolved after the nodes are read,
+	//then nodes input in local systems can be transformed.
+	//a model without nodes or a system that can't be resolved stops the translation even with "onerror continue":
+	if (!SortNodes())
+		return false;
+	if (!resolveCoords())
+		return false;
+	transformLcsNodes();
+
+	if (model.mergeTol > 0.0)
+		mergeCoincidentNodes();
+	finishTemps();
 
-	int numNodeDispsRead = 0;
 	if (model.cropModelWithDispNodes)
 	{
-		SortNodes();
 		//unsupported entities refer to nodes and element ids; finish filling them
 		//for cropped model this has to be done now, because it will throw bsurf processing off
-		SortElements();
-		finishUnsup();
-
-		//read the disp file to get the node ids that have disps. mark the nodes "havedisps".
-		//Also output the .srs file so engine can read the disps.
-		model.srrFile.Open(SRoutputMode);
-		model.srrFile.PrintLine("displacements");
-		model.nodeDispFile.Open(SRinputMode);
-		model.nodeDispFile.GetLine(line); //skip header
-		int uid;
-		line.setTokSep(',');
-		SRstring linesav;
-
-		while (1)
-		{
-			if (!model.nodeDispFile.GetLine(line))
-				break;
-			linesav = line;
-			if (!line.TokRead(uid))
-				break;
-			int nid = model.input.NodeFind(uid);
-			if (nid == -1 || nid > nnode)
-			{
-				//possibly a node on unsupported entity e.g. shell, just skip it:
-				continue;
-			}
-			model.srrFile.PrintLine(linesav.getStr());
-			SRnode* node = model.GetNode(nid);
-			node->hasDisp = true;
-			numNodeDispsRead++;
-		}
-		if (numNodeDispsRead < nnode)
-			model.partialDispFile = true;
-		model.nodeDispFile.Close();
+		if (!SortElements())
+			return false;
+		if (!finishUnsup())
+			return false;
+		//rforce origin nodes may be orphans, so this has to be done before they are deleted:
+		if (!finishVolumeForces())
+			return false;
+
+		//elements that were only kept so bsurfs could be processed can be removed now:
+		if (!cropBsurfOnlyElements())
+			return false;
+
+		//copy the disps of nodes in the model to the .srr file so engine can read them,
+		//and mark the nodes "hasDisp":
+		writeSrrDisps();
 
-		//now can crop elements, only keep those for which at least one node has disp:
-		cropElements();
-		elemUidOffSet = -1;
-		//packing elements will mess up elemUidOffSet and throw off searches.
-		//just set elemUidOffSet to -1 to force
-		//bsearch:
-		SortElements();
 		//fix mat active flags in case all elements removed that refer to a material:
-		for (int m = 0; m < model.GetNumMaterials(); m++)
-			model.GetMaterial(m)->active = false;
-		for (int e = 0; e < model.GetNumElements(); e++)
-		{
-			int mid = model.GetElement(e)->matid;
-			model.GetMaterial(mid)->active = true;
-		}
+		setActiveMaterials();
 
 		SetNodeElmentOwners();
-		//delete orphan nodes, pack nodes and resort:
-		int numNodesTotal = model.GetNumNodes();
-		int numfreed = 0;
-		for (int n = 0; n < numNodesTotal; n++)
-		{
-			if (model.GetNode(n)->isOrphan())
-			{
-				model.nodes.Free(n);
-				numfreed++;
-			}
-		}
-		if (numfreed > 0)
-		{
-			model.nodes.packNulls();
-			//packing nodes will mess up nodeuidoffset and throw off searches.
-			//just set nodeUidOffset to -1 to force
-			//bsearch:
-			nodeUidOffset = -1;
-			SortNodes();
-		}
+		//delete orphan nodes (e.g. nodes only referenced by bsurf elements or rforce):
+		removeOrphanNodes();
+		dispNodeUids.Free();
+		deckNodeUids.Free();
+		cropNodeUids.Free();
+		bsurfIds.Free();
+		if (model.breakout.type != noBreakout)
+			LOGPRINTLEVEL(logWarning, " breakout is ignored when cropping with displacement nodes");
 	}
 	else
 	{
-		SortNodes();
-		SortElements();
+		if (!SortElements())
+			return false;
 		SetNodeElmentOwners();
 		//unsupported entities refer to nodes and element ids; finish filling them:
-		finishUnsup();
+		if (!finishUnsup())
+			return false;
+		if (!finishVolumeForces())
+			return false;
+		if (model.breakout.type != noBreakout && !breakoutModel())
+			return false;
 	}
 
 
 
 
 	//forces, and constraints refer to nodes and element ids; finish filling them:
-	finishForces();
+	if (!finishForces())
+		return false;
 	finishConstraints();
+	if (stats.on)
+		countKeptEntities();
+	stats.Phase("finish");
 
 	model.inpFile.Close();
 
 	return true;
 }
 
-void SRinput::TopToBulk()
+bool SRinput::TopToBulk()
 {
+	//position the bdf file at the first bulk data card
+	//return:
+		//false if there is no "BEGIN BULK", else true
 	model.inpFile.ToTop();
 	SRstring line, tok;
-	//skip lines until "Begin Bulk"
+	//skip lines until "Begin Bulk". the case control is read the first time through
+	bool readCase = !caseControlRead;
+	caseControlRead = true;
+	SRsubcase defaults;
 	while (1)
 	{
 		if (!model.inpFile.GetLine(line))
-			ERROREXIT;
+		{
+			addCardError("BEGIN BULK", 0, "not found");
+			return false;
+		}
+		if (readCase)
+			readCaseControl(line, defaults);
 		tok = line.Token();
 		if (tok == "BEGIN")
 		{
@@ -308,6 +439,277 @@ void SRinput::TopToBulk()
 				break;
 		}
 	}
+	return true;
+}
+
+void SRinput::readCaseControl(SRstring& line, SRsubcase& defaults)
+{
+	//read a case control line for the subcases and their load and constraint selections
+	//spec:
+	//SUBCASE id
+	//LOAD = sid, SPC = sid, TEMP(LOAD) = sid (or TEMPERATURE(LOAD), TEMP, TEMPERATURE)
+	//selections above the first subcase are defaults for all subcases
+	//input:
+		//line = case control line
+		//defaults = selections above the first subcase
+	//output:
+		//model.subcases = a subcase is added for "SUBCASE", selections are applied to the last subcase or defaults
+
+	string card;
+	for (int i = 0; i < line.getLength(); i++)
+	{
+		char c = line.GetChar(i);
+		if (c == '$')
+			break;
+		if (c != ' ' && c != '\t')
+			card += (char) toupper(c);
+	}
+	SRsubcase* sc = &defaults;
+	if (model.subcases.GetNum() > 0)
+		sc = model.subcases.GetPointer(model.subcases.GetNum() - 1);
+	if (card.compare(0, 7, "SUBCASE") == 0)
+	{
+		SRsubcase subcase = defaults;
+		subcase.id = atoi(card.c_str() + 7);
+		model.subcases.pushBack(subcase);
+		return;
+	}
+	size_t eq = card.find('=');
+	if (eq == string::npos)
+		return;
+	string key = card.substr(0, eq);
+	int sid = atoi(card.c_str() + eq + 1);
+	if (key == "LOAD")
+		sc->loadSet = sid;
+	else if (key == "SPC")
+		sc->spcSet = sid;
+	else if (key == "TEMP(LOAD)" || key == "TEMPERATURE(LOAD)" || key == "TEMP" || key == "TEMPERATURE")
+		sc->tempSet = sid;
+}
+
+SRbdfIndex::SRbdfIndex()
+{
+	fileSize = 0;
+	hash = 0;
+	nnode = nelem = nforce = nvol = ntherm = nspcd = ncon = numunsup = 0;
+	linearMesh = false;
+	isNx = false;
+	for (int r = 0; r < numBdfRegions; r++)
+	{
+		regionFirst[r] = -1;
+		regionLast[r] = -1;
+	}
+}
+
+void SRinput::bdfIndexFileName(SRstring& name)
+{
+	//the card index is kept next to the bdf file, with ".xidx" appended to its name
+	name = model.inpFile.filename;
+	name += ".xidx";
+}
+
+void SRinput::indexBdfCard(SRbdfIndex& index, SRstring& line, bool isComment, bool isMat, SRindex seq)
+{
+	//add the card just read in the counting pass to the card index. the card is matched
+	//the same way as in the counting pass of BdfInput
+	//input:
+		//line, isComment, isMat = the card, see SRfile::GetBdfLine
+		//seq = number of cards read so far, including this one
+	//output:
+		//index updated
+	long long pos = model.inpFile.bdfCardPos;
+	int region = -1;
+	bool setup = false;
+	if (isComment)
+		setup = isMat;
+	else if (line.CompareUseLength("GRID"))
+		region = gridRegion;
+	else if (line.CompareUseLength("CHEXA") || line.CompareUseLength("CPENTA") || line.CompareUseLength("CTETRA"))
+		region = elementRegion;
+	else if (line.CompareUseLength("FORCE") || line.CompareUseLength("PLOAD4") || line.CompareUseLength("GRAV") ||
+		line.CompareUseLength("RFORCE") || line.CompareUseLength("TEMP"))
+		region = loadRegion;
+	else if (line.CompareUseLength("SPCD"))
+		region = constraintRegion;
+	else if (line.CompareUseLength("SPCADD") || isLoadCombination(line))
+		setup = true;
+	else if (line.CompareUseLength("SPC1") || line.CompareUseLength("SPC"))
+		region = constraintRegion;
+	else if (line.CompareUseLength("CORD") || line.CompareUseLength("MAT1") || line.CompareUseLength("PSOLID"))
+		setup = true;
+
+	if (region != -1)
+	{
+		if (index.regionFirst[region] == -1)
+			index.regionFirst[region] = pos;
+		index.regionLast[region] = pos;
+	}
+	if (setup)
+	{
+		SRbdfIndexCard card;
+		card.pos = pos;
+		card.line = model.inpFile.bdfCardLine;
+		card.seq = seq;
+		index.setupCards.push_back(card);
+	}
+}
+
+bool SRinput::readBdfIndex(SRbdfIndex& index)
+{
+	//read the card index of the bdf file, if it has one and it is up to date.
+	//the index is written the first time a file is translated with the index option. it holds
+	//the entity counts and flags found by the counting pass of BdfInput, and the offsets of the
+	//cards the counting pass reads, so later translations of the same file only read those cards.
+	//an index is up to date if the size and hash of the bdf file are the ones it was written for
+	//output:
+		//index = the card index if up to date, else empty with the size and hash of the bdf file
+	//return:
+		//true if the index was read and is up to date, else false
+	//note:
+		//the bdf file must be mapped
+
+	index.fileSize = model.inpFile.mapSize;
+	index.hash = model.inpFile.MapHash();
+
+	SRstring name;
+	bdfIndexFileName(name);
+	SRfile f;
+	if (!f.Existcheck(name) || !f.Open(SRinputMode, name.getStr()))
+		return false;
+	SRstring line;
+	long long v[8];
+	unsigned long long hash;
+	int version = 0;
+	bool ok = f.GetLine(line) && SSCANF(line.getStr(), "BdfTranslate card index %d", &version) == 1 &&
+		version == BDFINDEXVERSION;
+	ok = ok && f.GetLine(line) && SSCANF(line.getStr(), "%lld %llx", &v[0], &hash) == 2;
+	if (!ok || v[0] != index.fileSize || hash != index.hash)
+	{
+		f.Close();
+		LOGPRINT(" card index %s is out of date and will be rewritten", name.getStr());
+		return false;
+	}
+	ok = f.GetLine(line) && SSCANF(line.getStr(), "%lld %lld %lld %lld %lld %lld %lld %lld",
+		&v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]) == 8;
+	if (ok)
+	{
+		index.nnode = (SRindex) v[0];
+		index.nelem = (SRindex) v[1];
+		index.nforce = (SRindex) v[2];
+		index.nvol = (SRindex) v[3];
+		index.ntherm = (SRindex) v[4];
+		index.nspcd = (SRindex) v[5];
+		index.ncon = (SRindex) v[6];
+		index.numunsup = (SRindex) v[7];
+	}
+	int linear, nx;
+	ok = ok && f.GetLine(line) && SSCANF(line.getStr(), "%d %d", &linear, &nx) == 2;
+	index.linearMesh = (linear != 0);
+	index.isNx = (nx != 0);
+	for (int r = 0; ok && r < numBdfRegions; r++)
+		ok = f.GetLine(line) && SSCANF(line.getStr(), "%lld %lld", &index.regionFirst[r], &index.regionLast[r]) == 2;
+	long long ncard = 0;
+	ok = ok && f.GetLine(line) && SSCANF(line.getStr(), "%lld", &ncard) == 1 && ncard >= 0;
+	if (ok)
+		index.setupCards.resize((size_t) ncard);
+	for (long long c = 0; ok && c < ncard; c++)
+	{
+		SRbdfIndexCard& card = index.setupCards[(size_t) c];
+		ok = f.GetLine(line) && SSCANF(line.getStr(), "%lld %lld %lld", &v[0], &v[1], &v[2]) == 3 &&
+			v[0] >= 0 && v[0] < index.fileSize;
+		card.pos = v[0];
+		card.line = (SRindex) v[1];
+		card.seq = (SRindex) v[2];
+	}
+	f.Close();
+	if (!ok)
+	{
+		LOGPRINT(" card index %s could not be read and will be rewritten", name.getStr());
+		index.setupCards.clear();
+		return false;
+	}
+	LOGPRINT(" card index %s used, counting pass skipped", name.getStr());
+	return true;
+}
+
+void SRinput::writeBdfIndex(SRbdfIndex& index)
+{
+	//write the card index of the bdf file, see readBdfIndex
+	//input:
+		//index = the card index built in the counting pass of BdfInput
+	//note:
+		//failure to write the index is not an error; the next translation does the counting pass again
+
+	SRstring name;
+	bdfIndexFileName(name);
+	SRfile f;
+	f.Delete(name.getStr());
+	if (!f.Open(SRoutputMode, name.getStr()))
+	{
+		LOGPRINT(" card index %s could not be written", name.getStr());
+		return;
+	}
+	f.PrintLine("BdfTranslate card index %d", BDFINDEXVERSION);
+	f.PrintLine("%lld %llx //bdf file size, hash", index.fileSize, index.hash);
+	f.PrintLine("%lld %lld %lld %lld %lld %lld %lld %lld //nodes, elements, forces, volume forces, thermal, enforced displacements, constraints, unsupported",
+		(long long) index.nnode, (long long) index.nelem, (long long) index.nforce, (long long) index.nvol,
+		(long long) index.ntherm, (long long) index.nspcd, (long long) index.ncon, (long long) index.numunsup);
+	f.PrintLine("%d %d //linear mesh, NX", index.linearMesh ? 1 : 0, index.isNx ? 1 : 0);
+	const char* regionNames[numBdfRegions] = { "grids", "elements", "loads", "constraints" };
+	for (int r = 0; r < numBdfRegions; r++)
+		f.PrintLine("%lld %lld //first, last %s", index.regionFirst[r], index.regionLast[r], regionNames[r]);
+	f.PrintLine("%lld //setup cards", (long long) index.setupCards.size());
+	for (size_t c = 0; c < index.setupCards.size(); c++)
+	{
+		SRbdfIndexCard& card = index.setupCards[c];
+		f.PrintLine("%lld %lld %lld", card.pos, (long long) card.line, (long long) card.seq);
+	}
+	if (!f.Close())
+		LOGPRINT(" card index %s could not be written", name.getStr());
+	else
+		LOGPRINT(" card index %s written", name.getStr());
+}
+
+bool SRinput::isLoadCombination(SRstring& line)
+{
+	//check for a LOAD bulk card, without matching longer card names that start with "LOAD"
+	if (!line.CompareUseLength("LOAD"))
+		return false;
+	if (line.getLength() == 4)
+		return true;
+	char c = line.GetChar(4);
+	return (c == ' ' || c == ',' || c == '*' || c == '\t');
+}
+
+void SRinput::InputSetCombination(SRstring& line)
+{
+	//input a set that combines other sets
+	//spec:
+	//LOAD, sid, s, (si, lsidi) -repeated
+	//s = overall scale, si = scale of load set lsidi
+	//OR
+	//SPCADD, sid, (sidi) -repeated
+	SRsetCombination* comb;
+	bool isLoad = !line.CompareUseLength("SPCADD");
+	if (isLoad)
+		comb = model.loadCombinations.Add();
+	else
+		comb = model.spcCombinations.Add();
+	line.BdfToken(); //skip keyword
+	line.BdfRead(comb->sid);
+	if (isLoad)
+		line.BdfRead(comb->scale);
+	while (1)
+	{
+		double si = 1.0;
+		if (isLoad && !line.BdfRead(si))
+			break;
+		int sidi;
+		if (!line.BdfRead(sidi))
+			break;
+		comb->scales.push_back(si);
+		comb->sets.push_back(sidi);
+	}
 }
 
 void SRinput::CountEntities(int &num)
@@ -339,45 +741,46 @@ void SRinput::InputNode(SRstring& line)
 	// CoordId omitted for gcs
 
 	SRstring tok;
-	int id = model.GetNumNodes();
-	SRnode* node = model.nodes.Add();
+	SRindex id = model.GetNumNodes();
 	//skip "GRID" token
 	line.BdfToken();
 	SRstring condofs;
 	int uid, coordid, dispCoorduid;
 	double x, y, z;
 	line.BdfRead(uid);
-	if (id == 0)
-		nodeUidOffset = uid;
-	else if (nodeUidOffset != -1)
-	{
-		if (uid - nodeUidOffset != id)
-			nodeUidOffset = -1;
-	}
+	if (model.cropModelWithDispNodes && !cropNodeUids.Get(uid))
+		return;
 	line.BdfRead(coordid);
 	line.BdfRead(x);
 	line.BdfRead(y);
 	line.BdfRead(z);
 	line.BdfRead(dispCoorduid);
 	condofs = line.BdfToken(false);
+	int cid = -1;
 	if (coordid > 0)
 	{
-		if (anyCoordsReferenceGrids)
-		{
-			//rktd uncomment if need to support coord input that references grids, e.g. CORD1C
-			//nodeCoordIds.Put(id, coordid;
-		}
-		else
+		cid = CoordFind(coordid);
+		if (cid < 0 || cid >= model.Coords.GetNum())
 		{
-			SRvec3 pos;
-			int id = CoordFind(coordid);
-			SRcoord* coord = model.GetCoord(id);
-			coord->GetPos(x, y, z, pos);
-			x = pos.d[0];
-			y = pos.d[1];
-			z = pos.d[2];
+			cardError(line, "grid %d: coordinate system %d not found", uid, coordid);
+			return;
 		}
 	}
+	SRnode* node = model.nodes.Add();
+	if (id == 0)
+		nodeUidOffset = uid;
+	else if (nodeUidOffset != -1)
+	{
+		if (uid - nodeUidOffset != id)
+			nodeUidOffset = -1;
+	}
+	if (cid != -1)
+	{
+		//x, y, z are kept in the lcs for now. they are transformed in batches after all nodes are read
+		//and the coordinate systems are resolved:
+		lcsNodes.push_back(id);
+		lcsNodeCoords.push_back(cid);
+	}
 	if (condofs.getLength() > 0 && !condofs.isBlank())
 	{
 		SRconstraint* con = model.constraints.Add();
@@ -393,19 +796,17 @@ void SRinput::InputNode(SRstring& line)
 		}
 		con->entityId = uid;
 		con->uid = uid;
+		con->card = "GRID";
 	}
 	node->userId = uid;
 	node->pos.Assign(x, y, z);
 	if (dispCoorduid > 0)
-	{
-		int cid = CoordFind(dispCoorduid);
-		node->dispCoordid = cid;
-	}
+		node->dispCoordid = CoordFind(dispCoorduid);
 }
 
 static int brickBdftoSR[20] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 16, 17, 18, 19, 12, 13, 14, 15 };
 static int wedgeBdftoSR[20] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 13, 14, 9, 10, 11 };
-void SRinput::InputElement(SRstring& line, int& numFaces)
+void SRinput::InputElement(SRstring& line, SRindex& numFaces)
 {
 	//input elements
 	// Spec:
@@ -413,9 +814,8 @@ void SRinput::InputElement(SRstring& line, int& numFaces)
 	//eid, pid, g1,..,gn where n is 8 or 20 for hex, 6 or 15 for wedge (CPENTA), 4 or 10 for tet
 	SRstring tok;
 	int nnodes = 0;
-	int id = model.elements.GetNum();
-	SRelement* elem = model.elements.Add();
-	SRstring lineSav = line;
+	SRindex id = model.elements.GetNum();
+	SRelementType type = tet;
 	tok = line.BdfToken(false);
 	if (tok == "CHEXA")
 	{
@@ -423,9 +823,8 @@ void SRinput::InputElement(SRstring& line, int& numFaces)
 			nnodes = 8;
 		else
 			nnodes = 20;
-		elem->type = brick;
+		type = brick;
 		model.anybricks = true;
-		numFaces += 6;
 	}
 	else if (tok == "CPENTA")
 	{
@@ -433,9 +832,8 @@ void SRinput::InputElement(SRstring& line, int& numFaces)
 			nnodes = 6;
 		else
 			nnodes = 15;
-		elem->type = wedge;
+		type = wedge;
 		model.anywedges = true;
-		numFaces += 5;
 	}
 	else if (tok == "CTETRA")
 	{
@@ -443,11 +841,56 @@ void SRinput::InputElement(SRstring& line, int& numFaces)
 			nnodes = 4;
 		else
 			nnodes = 10;
-		elem->type = tet;
-		numFaces += 4;
+		type = tet;
 	}
 	int eid, pid, gid[20];
 	line.BdfRead(eid);
+	line.BdfRead(pid);
+	for (int i = 0; i < nnodes; i++)
+	{
+		if (!line.BdfRead(gid[i]))
+		{
+			//this can't happen unless mixed linear and quadratic mesh, not supported
+			cardError(line, "element %d: %d nodes expected, mixed linear and quadratic elements are not supported", eid, nnodes);
+			return;
+		}
+	}
+	bool bsurfOnly = false;
+	if (model.cropModelWithDispNodes)
+	{
+		//only keep elements that touch a node with disp,
+		//or elements that are referenced by bsurfs:
+		bool anyNodeWithDisp = false;
+		for (int i = 0; i < nnodes; i++)
+		{
+			if (dispNodeUids.Get(gid[i]))
+			{
+				anyNodeWithDisp = true;
+				break;
+			}
+		}
+		if (!anyNodeWithDisp)
+		{
+			if (!bsurfIds.Get(eid))
+				return;
+			bsurfOnly = true;
+		}
+	}
+	int propid = ElpropFind(pid);
+	if (propid < 0 || propid >= model.elProps.GetNum())
+	{
+		cardError(line, "element %d: element property %d not found", eid, pid);
+		return;
+	}
+	SRelement* elem = model.elements.Add();
+	elem->type = type;
+	elem->bsurfOnly = bsurfOnly;
+	if (type == brick)
+		numFaces += 6;
+	else if (type == wedge)
+		numFaces += 5;
+	else
+		numFaces += 4;
 	if (id == 0)
 		elemUidOffSet = eid;
 	else if (elemUidOffSet != -1)
@@ -455,12 +898,6 @@ void SRinput::InputElement(SRstring& line, int& numFaces)
 		if (eid - elemUidOffSet != id)
 			elemUidOffSet = -1;
 	}
-	line.BdfRead(pid);
-	for (int i = 0; i < nnodes; i++)
-	{
-		if (!line.BdfRead(gid[i]))
-			ERROREXIT;//this can't happen unless mixed linear and quadratic mesh, not supported
-	}
 	elem->id = id;
 	elem->uid = eid;
 	elem->nodeUIds.Allocate(nnodes);
@@ -486,10 +923,7 @@ void SRinput::InputElement(SRstring& line, int& numFaces)
 			elem->nodeUIds.Put(i, gid[i]);
 	}
 
-	id = ElpropFind(pid);
-	if(id == -1)
-		ERROREXIT;
-	SRElProperty* elp = model.elProps.GetPointer(id);
+	SRElProperty* elp = model.elProps.GetPointer(propid);
 	int mid = elp->matid;
 	SRmaterial* mat = model.materials.GetPointer(mid);
 #if 0
@@ -541,7 +975,6 @@ void SRinput::InputMaterial(SRstring& line, bool matNameWasRead, SRstring& matna
 	//SS = allowable stress in tension
 
 	//skip MAT1:
-	SRstring lineSav = line;
 	line.BdfToken();
 
 	int mid = model.materials.GetNum();
@@ -633,7 +1066,7 @@ void SRinput::InputForce(SRstring& line)
 	if (line.CompareUseLength("FORCE1"))
 	{
 		line.BdfToken(); //skip FORCE1
-		line.BdfRead(lsid);//rktd: SR doesn't currentlty use this. write out when SR needs it.
+		line.BdfRead(lsid);
 		line.BdfRead(gid);
 		line.BdfRead(magIn);
 		int guid1, guid2;
@@ -641,6 +1074,7 @@ void SRinput::InputForce(SRstring& line)
 		line.BdfRead(guid2);
 		force = model.forces.Add();
 		force->type = nodalForce;
+		force->setId = lsid;
 		force->entityId = gid;
 		force->uid = gid;
 		force->nv[0] = guid1;
@@ -652,7 +1086,7 @@ void SRinput::InputForce(SRstring& line)
 	else if (line.CompareUseLength("FORCE"))
 	{
 		line.BdfToken(); //skip FORCE
-		line.BdfRead(lsid);//rktd: SR doesn't currentlty use this. write out when SR needs it.
+		line.BdfRead(lsid);
 		line.BdfRead(gid);
 		line.BdfRead(cuid);
 		line.BdfRead(magIn);
@@ -664,9 +1098,13 @@ void SRinput::InputForce(SRstring& line)
 		f.Scale(mag);
 		force = model.forces.Add();
 		force->type = nodalForce;
+		force->setId = lsid;
 		force->entityId = gid;
 		force->uid = gid;
-		force->coordId = CoordFind(cuid);
+		if (cuid > 0)
+			force->coordId = CoordFind(cuid);
+		else
+			force->coordId = -1;
 		force->forceVals.Allocate(1, 3);
 		force->forceVals.Put(0, 0, f.d[0]);
 		force->forceVals.Put(0, 1, f.d[1]);
@@ -684,7 +1122,11 @@ void SRinput::InputForce(SRstring& line)
 			SRstring tmp;
 			tmp.Copy(s);
 			if (tmp.CompareUseLength("THRU"))
+			{
+				if (stats.on)
+					stats.Get("PLOAD4").dropped++;
 				return;
+			}
 		}
 
 		line.BdfToken(); //skip PLOAD4
@@ -722,12 +1164,15 @@ void SRinput::InputForce(SRstring& line)
 
 		force->pressure = pressure;
 		force->type = faceForce;
+		force->setId = lsid;
 		force->entityId = eluid;
 		if (pressure)
 			force->forceVals.Allocate(4, 1);
 		else
 		{
-			for (int i = 0; i < 2; i++)
+			//column 0 = corner pressures, column 1 = direction, until finishForce:
+			force->forceVals.Allocate(4, 2);
+			for (int i = 0; i < 3; i++)
 				force->forceVals.Put(i, 1, n.d[i]);
 		}
 		for (int i = 0; i < 4; i++)
@@ -747,7 +1192,7 @@ void SRinput::InputVolumeForce(SRstring& line)
 		// GRAV,loadcaseid,cid,mag,fx,fy,fz
 		line.BdfToken(); //skip GRAV
 		int lsid, cuid;
-		line.BdfRead(lsid);//rktd: SR doesn't currently use this. write out when SR needs it.
+		line.BdfRead(lsid);
 		line.BdfRead(cuid);
 		double mag;
 		SRvec3 f;
@@ -758,13 +1203,10 @@ void SRinput::InputVolumeForce(SRstring& line)
 		f.Scale(mag);
 		SRvolumeForce* vol = model.volumeForces.Add();
 		vol->type = gravity;
+		vol->setId = lsid;
+		//transformed to gcs in finishVolumeForces, after the coordinate systems are resolved:
 		if (cuid > 0)
-		{
-			int cid = CoordFind(cuid);
-			SRcoord* coord = model.GetCoord(cid);
-			SRvec3 p = coord->origin;
-			coord->VecTransform(p, f);
-		}
+			vol->coordId = CoordFind(cuid);
 		vol->g1 = f.d[0];
 		vol->g2 = f.d[1];
 		vol->g3 = f.d[2];
@@ -774,39 +1216,28 @@ void SRinput::InputVolumeForce(SRstring& line)
 		// RFORCE,loadcaseid,cid,grid,omega, r1,r2,r3, alpha
 		line.BdfToken(); //skip FORCE
 		int lsid, cuid, grid;
-		line.BdfRead(lsid);//rktd: SR doesn't currently use this. write out when SR needs it.
+		line.BdfRead(lsid);
 		line.BdfRead(cuid);
 		line.BdfRead(grid);
-		SRvec3 origin, axis;
-		int nid = NodeFind(grid);
-		if (nid == -1)
-		{
-			//force refers to node not found in model, skip it:
-			return;
-		}
-		origin.Copy(model.GetNode(nid)->pos);
+		SRvec3 axis;
 		double alpha, omega;
 		line.BdfRead(omega);
 		omega *= TWOPI; //see MSC linear ug p; msc use rev/time so 2pi converts to rad/time
 		line.BdfRead(axis.d[0]);
 		line.BdfRead(axis.d[1]);
 		line.BdfRead(axis.d[2]);
-		line.TokRead(alpha);
+		line.BdfRead(alpha);
 		alpha *= TWOPI;
-		if (cuid > 0)
-		{
-			int cid = CoordFind(cuid);
-			SRcoord* coord = model.GetCoord(cid);
-			SRvec3 p = coord->origin;
-			coord->VecTransform(p, axis);
-		}
 		SRvolumeForce* vol = model.volumeForces.Add();
+		if (cuid > 0)
+			vol->coordId = CoordFind(cuid);
 		vol->type = centrifugal;
-		axis.PlusAssign(origin);
+		vol->setId = lsid;
 		vol->omega = omega;
 		vol->alpha = alpha;
+		//axis is relative to the origin node until finishVolumeForces, because nodes aren't sorted yet:
 		vol->axis.Copy(axis);
-		vol->origin.Copy(origin);
+		vol->originGid = grid;
 	}
 
 }
@@ -824,17 +1255,14 @@ void SRinput::InputThermal(SRstring& line)
 		int guid;
 		if (!line.BdfRead(guid))
 			break;
-		int nid = NodeFind(guid);
-		if (nid == -1)
-		{
-			//force refers to node not found in model, skip it:
-			return;
-		}
-		SRnode* node = model.GetNode(guid);
 		double T;
 		line.BdfRead(T);
-		node->hasTemp = true;
-		node->Temp = T;
+		//the nodes aren't sorted yet, so the temperature is applied to its node in finishTemps:
+		SRnodeTemp temp;
+		temp.setId = lsid;
+		temp.nodeUid = guid;
+		temp.T = T;
+		model.temps.pushBack(temp);
 	}
 }
 
@@ -846,80 +1274,208 @@ void SRinput::InputCoordinate(SRstring& line)
 	//CORD2C, uid, refid, a1,a2,a3,b1,b2,b3,c1,c2,c3
 	//CORD2R, uid, refid, a1,a2,a3,b1,b2,b3,c1,c2,c3
 	//CORD2S, uid, refid, a1,a2,a3,b1,b2,b3,c1,c2,c3
-	int id = model.Coords.GetNum();
-	int uid, refid;
-
-	SRcoord* coord = model.Coords.Add();
-	if (line.CompareUseLength("CORD2C"))
+	//CORD1C, uid, g1, g2, g3, uid2, g12, g22, g32 (second system optional)
+	//CORD1R, CORD1S same as CORD1C
+	//note:
+		//the definitions are stored; the systems are resolved to gcs by resolveCoords once the grids are read
+
+	SRcoordType type;
+	if (line.CompareUseLength("CORD2C") || line.CompareUseLength("CORD1C"))
+		type = cylindrical;
+	else if (line.CompareUseLength("CORD2R") || line.CompareUseLength("CORD1R"))
+		type = cartesian;
+	else if (line.CompareUseLength("CORD2S") || line.CompareUseLength("CORD1S"))
+		type = spherical;
+	else
 	{
-		line.BdfToken(); //skip CORD2c keyword
-		coord->type = cylindrical;
+		//can't handle cord3's
+		cardError(line, "coordinate system type not supported");
+		return;
 	}
-	else if (line.CompareUseLength("CORD2R"))
+	bool cord1 = line.CompareUseLength("CORD1");
+	line.BdfToken(); //skip keyword
+	int nsys = cord1 ? 2 : 1;
+	for (int s = 0; s < nsys; s++)
 	{
-		line.BdfToken(); //skip CORD2c keyword
-		coord->type = cartesian;
+		int uid;
+		if (!line.BdfRead(uid))
+			break; //second system on a CORD1 card is optional
+		int id = model.Coords.GetNum();
+		SRcoord* coord = model.Coords.Add();
+		coord->type = type;
+		coord->uid = uid;
+		coord->cardLine = model.inpFile.bdfCardLine;
+		if (id == 0)
+			CoordUidOffset = uid;
+		else if (CoordUidOffset != -1)
+		{
+			if (uid - CoordUidOffset != id)
+				CoordUidOffset = -1;
+		}
+		if (cord1)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				line.BdfRead(coord->defGrids[k]);
+				//the grids are needed to resolve the system even if they are cropped:
+				if (model.cropModelWithDispNodes)
+					cropNodeUids.Set(coord->defGrids[k]);
+			}
+		}
+		else
+		{
+			int refid;
+			line.BdfRead(refid);
+			if (refid > 0)
+				coord->otherCoordid = refid;
+			for (int k = 0; k < 3; k++)
+			{
+				for (int dof = 0; dof < 3; dof++)
+					line.BdfRead(coord->defPoints[k].d[dof]);
+			}
+		}
+		char buf[100];
+		SPRINTF(buf, "LCS%d", id);
+		coord->name.Copy(buf);
 	}
-	else if (line.CompareUseLength("CORD2S"))
-	{
-		line.BdfToken(); //skip CORD2S keyword
-		coord->type = spherical;
+}
+
+bool SRinput::resolveCoords()
+{
+	//resolve the coordinate systems to gcs. a CORD2 system is defined by points in its reference system,
+	//a CORD1 system by grids, which may be in local systems themselves. each system is resolved once,
+	//after the systems it depends on, and then holds its gcs basis and origin, so node, force, and
+	//volume force transforms are a single application of it
+	//return:
+		//false if a system can't be resolved, else true
+	//note:
+		//has to be called after the nodes are read and sorted, before transformLcsNodes
+
+	int ncoord = model.Coords.GetNum();
+	if (ncoord == 0)
+		return true;
+	//systems of grids that are input in local systems, only needed if there are CORD1's:
+	vector <int> nodeCoords;
+	for (int c = 0; c < ncoord; c++)
+	{
+		if (model.GetCoord(c)->defGrids[0] != -1)
+		{
+			nodeCoords.assign(model.GetNumNodes(), -1);
+			for (SRindex i = 0; i < (SRindex) lcsNodes.size(); i++)
+				nodeCoords[lcsNodes[i]] = lcsNodeCoords[i];
+			break;
+		}
 	}
-	else
-		ERROREXIT; //can't handle cord1's yet
-	line.BdfRead(uid);
-	coord->uid = uid;
-	if (id == 0)
-		CoordUidOffset = uid;
-	else if (CoordUidOffset != -1)
+	vector <char> state(ncoord, 0);
+	for (int c = 0; c < ncoord; c++)
 	{
-		if (uid - CoordUidOffset != id)
-			CoordUidOffset = -1;
+		if (!resolveCoord(c, state, nodeCoords))
+		{
+			SCREENPRINT(" translation stopped: coordinate system %d can't be resolved, see xlate_errors.txt\n", model.GetCoord(c)->uid);
+			return false;
+		}
 	}
+	return true;
+}
 
-	line.BdfRead(refid);
-	if (refid > 0)
-		coord->otherCoordid = refid;
-	int dof;
-	SRvec3 p13, p3;
-	for (dof = 0; dof < 3; dof++)
-		line.BdfRead(coord->origin.d[dof]);
-	for (dof = 0; dof < 3; dof++)
-		line.BdfRead(p3.d[dof]);
-	for (dof = 0; dof < 3; dof++)
-		line.BdfRead(p13.d[dof]);
-	p13.MinusAssign(coord->origin);
-	p3.Subtract(coord->origin, coord->e3);
-	coord->e3.Normalize();
-	coord->e3.Cross(p13, coord->e2);
-	coord->e2.Normalize();
-	coord->e2.Cross(coord->e3, coord->e1);
-	char buf[100];
-	SPRINTF(buf, "LCS%d", id);
-	coord->name.Copy(buf);
-	SRvec3 e1g, e3g;
-	e1g.Assign(1.0, 0.0, 0.0);
-	e3g.Assign(0.0, 0.0, 1.0);
-	coord->gcsaligned = true;
-	if (e1g.Dot(coord->e1) < (1.0 - SMALL))
-		coord->gcsaligned = false;
-	if (e3g.Dot(coord->e3) < (1.0 - SMALL))
-		coord->gcsaligned = false;
+bool SRinput::coordError(SRcoord* coord, const char* fmt, ...)
+{
+	//record a card error for the card that defined coord, see addCardError
+	//return:
+		//false, so resolveCoord can return it
+	const char* typeChar = "R";
+	if (coord->type == cylindrical)
+		typeChar = "C";
+	else if (coord->type == spherical)
+		typeChar = "S";
+	char card[16];
+	SPRINTF(card, "CORD%d%s", coord->defGrids[0] != -1 ? 1 : 2, typeChar);
+	char reason[MAXLINELENGTH];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(reason, MAXLINELENGTH, fmt, args);
+	va_end(args);
+	addCardError(card, coord->cardLine, reason);
+	return false;
 }
 
-void SRinput::InputConstraint(SRstring& line)
+bool SRinput::resolveCoord(int c, vector <char>& state, vector <int>& nodeCoords)
 {
-	//input constraints
-	//spec:
-	//SPC, setid, (gid, condof, enfd)
-	//gid = node id
-	//condof = 1 for x, 2 for y, 3 for z, 12 for x and y, omitted for unconstraine
-	//enfd = disp value, applied to all dofs specified in condof
-	//the 3 items in parm may be repeated up to 12x
-	//OR
-	//SPC1,setid,(condof,gid) -repeated
-	SRstring condofs;
-	int setid, gid;
+	//resolve coordinate system c to gcs, after the systems it depends on. see resolveCoords
+	//input:
+		//c = coordinate system number
+		//state = 0 for systems not resolved yet, 1 while resolving, 2 when resolved
+		//nodeCoords = system of each node input in a local system, -1 for gcs
+	//return:
+		//false if the system can't be resolved, else true
+	if (state[c] == 2)
+		return true;
+	SRcoord* coord = model.GetCoord(c);
+	if (state[c] == 1)
+		return coordError(coord, "coordinate system %d references itself through its reference systems or grids", coord->uid);
+	state[c] = 1;
+	SRvec3 p[3];
+	if (coord->defGrids[0] != -1)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			SRindex nid = NodeFind(coord->defGrids[k]);
+			if (nid == -1)
+				return coordError(coord, "grid %d of coordinate system %d not found", coord->defGrids[k], coord->uid);
+			SRvec3& pos = model.GetNode(nid)->pos;
+			int gc = nodeCoords[nid];
+			if (gc == -1)
+				p[k].Copy(pos);
+			else
+			{
+				if (!resolveCoord(gc, state, nodeCoords))
+					return false;
+				double x = pos.d[0], y = pos.d[1], z = pos.d[2];
+				model.GetCoord(gc)->GetPos(x, y, z, p[k]);
+			}
+		}
+	}
+	else
+	{
+		int rid = -1;
+		if (coord->otherCoordid > 0)
+		{
+			rid = CoordFind(coord->otherCoordid);
+			if (rid < 0 || rid >= model.Coords.GetNum())
+				return coordError(coord, "reference system %d of coordinate system %d not found", coord->otherCoordid, coord->uid);
+			if (!resolveCoord(rid, state, nodeCoords))
+				return false;
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			if (rid == -1)
+				p[k].Copy(coord->defPoints[k]);
+			else
+			{
+				double x = coord->defPoints[k].d[0], y = coord->defPoints[k].d[1], z = coord->defPoints[k].d[2];
+				model.GetCoord(rid)->GetPos(x, y, z, p[k]);
+			}
+		}
+	}
+	if (!coord->CreateFromPoints(p[0], p[1], p[2]))
+		return coordError(coord, "points of coordinate system %d are coincident or on one line", coord->uid);
+	state[c] = 2;
+	return true;
+}
+
+void SRinput::InputConstraint(SRstring& line)
+{
+	//input constraints
+	//spec:
+	//SPC, setid, (gid, condof, enfd)
+	//gid = node id
+	//condof = 1 for x, 2 for y, 3 for z, 12 for x and y, omitted for unconstraine
+	//enfd = disp value, applied to all dofs specified in condof
+	//the 3 items in parm may be repeated up to 12x
+	//OR
+	//SPC1,setid,(condof,gid) -repeated
+	SRstring condofs;
+	int setid, gid;
 	double enfd;
 
 	if (line.CompareUseLength("SPC1"))
@@ -947,6 +1503,8 @@ void SRinput::InputConstraint(SRstring& line)
 
 			con->entityId = gid;
 			con->uid = gid;
+			con->setId = setid;
+			con->card = "SPC1";
 		}
 	}
 	else if (line.CompareUseLength("SPC"))
@@ -961,6 +1519,8 @@ void SRinput::InputConstraint(SRstring& line)
 			SRconstraint* con = model.constraints.Add();
 			con->entityId = gid;
 			con->uid = gid;
+			con->setId = setid;
+			con->card = "SPC";
 			condofs = line.BdfToken(false);
 			for (int i = 0; i < condofs.getLength(); i++)
 			{
@@ -999,6 +1559,7 @@ void SRinput::InputEnfd(SRstring& line)
 	line.BdfRead(enfdval);
 	SRenfd* enfd = model.enfds.Add();
 	enfd->nuid = gid;
+	enfd->setId = setid;
 	enfd->enfdVal = enfdval;
 	for (int i = 0; i < condofs.getLength(); i++)
 	{
@@ -1020,13 +1581,14 @@ void SRinput::inputUnsupported(SRstring &line)
 			line.CompareUseLength("CW") || line.CompareUseLength("CF") || line.CompareUseLength("Ci") ||
 			line.CompareUseLength("RB") || line.CompareUseLength("RJ") || line.CompareUseLength("MPC"))
 	*/
-	SRstring lineSav = line;
 	int nnodes = 0;
-	int eid, pid, cid, gid[100000];//this is really high because # of nodes in mpcs/bsurfs is arbitrary
+	int eid, pid, cid;
+	vector <int> gid(8);//grows as needed because # of nodes in mpcs/bsurfs is arbitrary
 	SRstring tok;
 	tok = line.BdfToken(false);
 	int dof;
 	SRunsup *unsup = model.unsups.Add();
+	unsup->cardLine = model.inpFile.bdfCardLine;
 	if (tok.CompareUseLength("CELAS1"))
 	{
 		nnodes = 2;
@@ -1172,6 +1734,8 @@ void SRinput::inputUnsupported(SRstring &line)
 		line.BdfRead(eid);//this is really sid but not needed
 		while (1)
 		{
+			if (nnodes >= (int) gid.size())
+				gid.resize(2 * gid.size());
 			line.BdfRead(gid[nnodes]);
 			line.BdfRead(pid);
 			if (!line.BdfRead(coeff))
@@ -1194,10 +1758,17 @@ void SRinput::inputUnsupported(SRstring &line)
 			if (tok.isBlank())
 				break;
 			int gidt;
-			tok.BdfRead(gidt);
-			int nid = NodeFind(gidt);
-			if (nid < 0)
+			gidt = tok.IntRead();
+			if (model.cropModelWithDispNodes)
+			{
+				//nodes of cropped elements are not created, check the grids in the deck instead:
+				if (!deckNodeUids.Get(gidt))
+					break;
+			}
+			else if (NodeFind(gidt) < 0)
 				break;
+			if (nnodes >= (int) gid.size())
+				gid.resize(2 * gid.size());
 			gid[nnodes] = gidt;
 			nnodes++;
 		}
@@ -1235,6 +1806,8 @@ void SRinput::inputUnsupported(SRstring &line)
 		{
 			if (!line.BdfRead(guid))
 				break;
+			if (nnodes >= (int) gid.size())
+				gid.resize(2 * gid.size());
 			gid[nnodes] = guid;
 			nnodes++;
 		}
@@ -1293,15 +1866,15 @@ void SRinput::checkUnsupportedTouchesNonOrphan()
 	if (!model.anyGeneralUnsupportedNode && !model.anyShellOrBeamNode)
 		return;
 
-	int nnode = model.GetNumNodes();
+	SRindex nnode = model.GetNumNodes();
 
 	double distTol = RELSMALL*model.size;
-	for (int n = 0; n < nnode; n++)
+	for (SRindex n = 0; n < nnode; n++)
 	{
 		SRnode *node = model.GetNode(n);
 		if (node->isOrphan() || node->shellOrBeamNode || node->unSupported)
 			continue;
-		for (int n2 = 0; n2 < nnode; n2++)
+		for (SRindex n2 = 0; n2 < nnode; n2++)
 		{
 			SRnode* node2 = model.GetNode(n2);
 			if (node2->unSupported)
@@ -1318,26 +1891,418 @@ void SRinput::checkUnsupportedTouchesNonOrphan()
 	}
 }
 
-void SRinput::cropElements()
+void SRinput::mergeCoincidentNodes()
 {
-	int numfreed = 0;
-	int nel = model.GetNumElements();
-	for (int e = 0; e < nel; e++)
+	//equivalence nodes closer than model.mergeTol times the model size: each group of coincident nodes
+	//is merged into its first node in input order. element connectivity, loads, constraints and
+	//unsupported entities are rewritten to refer to the kept nodes, and the merged nodes are removed.
+	//the merge map is written to the log
+	//note:
+		//nodes are binned into a spatial hash with cells the size of the tolerance, so coincident nodes are
+		//in the same or neighboring cells. each node checks the 27 cells around it, so this is linear in the
+		//number of nodes for reasonable tolerances. chained groups (a near b, b near c) are merged together
+
+	model.SetBB();
+	double tol = model.mergeTol * model.size;
+	SRindex nnodeModel = model.GetNumNodes();
+	if (tol <= 0.0 || nnodeModel < 2)
+		return;
+	double xmin[3] = { BIG, BIG, BIG };
+	for (SRindex n = 0; n < nnodeModel; n++)
 	{
-		SRelement* elem = model.GetElement(e);
-		//check if any of the element's nodes have displacements.
-		bool anyNodeWithDisp = false;
-		int nnode = elem->GetNumNodes();
-		for (int n = 0; n < nnode; n++)
+		for (int i = 0; i < 3; i++)
+			xmin[i] = min(xmin[i], model.GetNode(n)->pos.d[i]);
+	}
+	double cellScale = 1.0 / tol;
+	auto cellOf = [&](SRindex n, int i) { return (long long) floor((model.GetNode(n)->pos.d[i] - xmin[i]) * cellScale); };
+	auto cellHash = [](long long ix, long long iy, long long iz)
+	{
+		unsigned long long h = (unsigned long long) ix * 0x9e3779b97f4a7c15ULL;
+		h ^= (unsigned long long) iy * 0xc2b2ae3d27d4eb4fULL + (h << 6) + (h >> 2);
+		h ^= (unsigned long long) iz * 0x165667b19e3779f9ULL + (h << 6) + (h >> 2);
+		return h;
+	};
+
+	//nodes sorted by cell hash, so the nodes of a cell are contiguous:
+	vector <pair <unsigned long long, SRindex> > cellNodes(nnodeModel);
+	SRparallel::For(nnodeModel, FINISHCHUNKSIZE, [&](int c, long long begin, long long end)
+	{
+		for (SRindex n = begin; n < end; n++)
+			cellNodes[n] = make_pair(cellHash(cellOf(n, 0), cellOf(n, 1), cellOf(n, 2)), n);
+	});
+	sort(cellNodes.begin(), cellNodes.end());
+	//open addressing table from cell hash to the first entry of the cell in cellNodes:
+	SRindex tableSize = 16;
+	while (tableSize < 2 * nnodeModel)
+		tableSize *= 2;
+	vector <SRindex> table(tableSize, -1);
+	for (SRindex k = 0; k < nnodeModel; k++)
+	{
+		if (k > 0 && cellNodes[k].first == cellNodes[k - 1].first)
+			continue;
+		SRindex slot = (SRindex) (cellNodes[k].first & (tableSize - 1));
+		while (table[slot] != -1)
+			slot = (slot + 1) & (tableSize - 1);
+		table[slot] = k;
+	}
+
+	//pairs of coincident nodes, lower node number first:
+	vector <vector <pair <SRindex, SRindex> > > chunkPairs(SRparallel::GetNumChunks(nnodeModel, FINISHCHUNKSIZE));
+	SRparallel::For(nnodeModel, FINISHCHUNKSIZE, [&](int c, long long begin, long long end)
+	{
+		for (SRindex n = begin; n < end; n++)
 		{
-			SRnode* node = model.GetNodeFromUid(elem->nodeUIds.Get(n));
-			if (node != NULL && node->hasDisp)
+			SRvec3& p = model.GetNode(n)->pos;
+			long long ic[3] = { cellOf(n, 0), cellOf(n, 1), cellOf(n, 2) };
+			for (int dx = -1; dx <= 1; dx++)
 			{
-				anyNodeWithDisp = true;
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					for (int dz = -1; dz <= 1; dz++)
+					{
+						unsigned long long h = cellHash(ic[0] + dx, ic[1] + dy, ic[2] + dz);
+						SRindex slot = (SRindex) (h & (tableSize - 1));
+						while (table[slot] != -1 && cellNodes[table[slot]].first != h)
+							slot = (slot + 1) & (tableSize - 1);
+						if (table[slot] == -1)
+							continue;
+						for (SRindex k = table[slot]; k < nnodeModel && cellNodes[k].first == h; k++)
+						{
+							SRindex m = cellNodes[k].second;
+							if (m < n && model.GetNode(m)->pos.Distance(p) <= tol)
+								chunkPairs[c].push_back(make_pair(m, n));
+						}
+					}
+				}
+			}
+		}
+	});
+
+	//union-find, the root of each group is its lowest node number:
+	vector <SRindex> keeper(nnodeModel);
+	for (SRindex n = 0; n < nnodeModel; n++)
+		keeper[n] = n;
+	auto findRoot = [&](SRindex n)
+	{
+		SRindex r = n;
+		while (keeper[r] != r)
+			r = keeper[r];
+		while (keeper[n] != r)
+		{
+			SRindex next = keeper[n];
+			keeper[n] = r;
+			n = next;
+		}
+		return r;
+	};
+	SRindex npair = 0;
+	for (int c = 0; c < (int) chunkPairs.size(); c++)
+	{
+		for (SRindex k = 0; k < (SRindex) chunkPairs[c].size(); k++)
+		{
+			SRindex r1 = findRoot(chunkPairs[c][k].first);
+			SRindex r2 = findRoot(chunkPairs[c][k].second);
+			if (r1 < r2)
+				keeper[r2] = r1;
+			else if (r2 < r1)
+				keeper[r1] = r2;
+			npair++;
+		}
+		vector <pair <SRindex, SRindex> >().swap(chunkPairs[c]);
+	}
+	if (npair == 0)
+	{
+		LOGPRINT(" merge nodes: no coincident nodes within %lg", tol);
+		return;
+	}
+	for (SRindex n = 0; n < nnodeModel; n++)
+		keeper[n] = findRoot(n);
+
+	auto keptUid = [&](int uid)
+	{
+		SRindex nid = NodeLookup(uid);
+		if (nid == -1 || keeper[nid] == nid)
+			return uid;
+		return model.GetNodeUid(keeper[nid]);
+	};
+
+	//the node ids on BSURFS follow element ids, and how many there are depends on the element.
+	//they are rewritten before the elements, while the faces can still be matched to the element nodes:
+	bool anyBsurf = false;
+	for (SRindex u = 0; u < model.unsups.GetNum(); u++)
+	{
+		if (model.unsups.GetPointer(u)->isBsurf)
+			anyBsurf = true;
+	}
+	if (anyBsurf)
+		SortElements();
+	for (SRindex u = 0; u < model.unsups.GetNum(); u++)
+	{
+		SRunsup* unsup = model.unsups.GetPointer(u);
+		int nids = unsup->gids.GetNum();
+		if (!unsup->isBsurf)
+		{
+			for (int i = 0; i < nids; i++)
+				unsup->gids.Put(i, keptUid(unsup->gids.Get(i)));
+			continue;
+		}
+		int nread = 0;
+		while (nread < nids)
+		{
+			SRindex eid = ElemLookup(unsup->gids.Get(nread));
+			nread++;
+			if (eid == -1)
+				break;
+			int first = nread;
+			int gidFace[4];
+			findFaceNodes(model.GetElement(eid), unsup->gids.d, nread, gidFace);
+			for (int i = first; i < nread; i++)
+				unsup->gids.Put(i, keptUid(unsup->gids.Get(i)));
+		}
+	}
+	SRparallel::For(model.GetNumElements(), FINISHCHUNKSIZE, [&](int c, long long begin, long long end)
+	{
+		for (SRindex e = begin; e < end; e++)
+		{
+			SRelement* elem = model.GetElement(e);
+			for (int i = 0; i < elem->GetNumNodes(); i++)
+				elem->nodeUIds.Put(i, keptUid(elem->nodeUIds.Get(i)));
+		}
+	});
+	for (SRindex f = 0; f < model.GetNumForces(); f++)
+	{
+		SRforce* force = model.GetForce(f);
+		if (force->type == nodalForce)
+			force->entityId = keptUid(force->entityId);
+		for (int i = 0; i < 4; i++)
+		{
+			if (force->nv[i] != -1)
+				force->nv[i] = keptUid(force->nv[i]);
+		}
+	}
+	for (SRindex c = 0; c < model.GetNumConstraints(); c++)
+	{
+		SRconstraint* con = model.GetConstraint(c);
+		if (con->type == nodalCon)
+			con->entityId = keptUid(con->entityId);
+	}
+	for (SRindex i = 0; i < model.enfds.GetNum(); i++)
+	{
+		SRenfd* enfd = model.enfds.GetPointer(i);
+		enfd->nuid = keptUid(enfd->nuid);
+	}
+	for (SRindex i = 0; i < model.temps.GetNum(); i++)
+	{
+		SRnodeTemp* temp = model.temps.GetPointer(i);
+		temp->nodeUid = keptUid(temp->nodeUid);
+	}
+	for (SRindex v = 0; v < model.volumeForces.GetNum(); v++)
+	{
+		SRvolumeForce* vol = model.volumeForces.GetPointer(v);
+		if (vol->originGid != -1)
+			vol->originGid = keptUid(vol->originGid);
+	}
+
+	//log the merge map, remove the merged nodes and resort:
+	SRindex nmerged = 0;
+	for (SRindex n = 0; n < nnodeModel; n++)
+	{
+		if (keeper[n] == n)
+			continue;
+		SRnode* node = model.GetNode(n);
+		SRnode* kept = model.GetNode(keeper[n]);
+		LOGPRINT(" node %d merged into %d", node->userId, kept->userId);
+		model.nodes.Free(n);
+		nmerged++;
+	}
+	LOGPRINT(" merge nodes: " SRINDEXFMT " nodes merged within %lg", nmerged, tol);
+	model.nodes.packNulls();
+	nodeUidOffset = -1;
+	lastNodeUid = -1;
+	SortNodes();
+}
+
+void SRinput::readDispNodes()
+{
+	//read the node ids in the displacement file, before the bdf file is read,
+	//so that the model can be cropped while the bdf file is read
+
+	vector <SRdispFileChunk> chunks;
+	scanDispFile(false, chunks);
+	for (int c = 0; c < (int) chunks.size(); c++)
+	{
+		SRdispFileChunk& chunk = chunks[c];
+		for (int i = 0; i < (int) chunk.uids.size(); i++)
+			dispNodeUids.Set(chunk.uids[i]);
+		if (chunk.stopped)
+			break;
+	}
+	model.nodeDispFile.Unmap();
+}
+
+static inline bool dispRowRead(const char* p, const char* end, int& uid)
+{
+	//read the node id at the start of a displacement file row, same rules as sscanf "%d"
+	//input:
+		//p = start of row
+		//end = end of row
+	//output:
+		//uid = node id
+	//return:
+		//true if a node id was read, false if the row is blank or doesn't start with an integer
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+	bool neg = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		neg = (*p == '-');
+		p++;
+	}
+	if (p >= end || *p < '0' || *p > '9')
+		return false;
+	long long v = 0;
+	while (p < end && *p >= '0' && *p <= '9')
+	{
+		v = v * 10 + (*p - '0');
+		p++;
+	}
+	uid = (int) (neg ? -v : v);
+	return true;
+}
+
+bool SRinput::scanDispFile(bool deckNodesOnly, vector <SRdispFileChunk>& chunks)
+{
+	//read the leading node id of each row of the displacement file.
+	//the file is mapped and split into chunks at row boundaries, one per thread.
+	//only the node id is parsed, the rest of the row is not tokenized
+	//input:
+		//deckNodesOnly = true to only accept rows for nodes in the bdf file (deckNodeUids)
+		//                and record the file spans of the accepted rows
+	//output:
+		//chunks = rows read by each thread, in file order
+	//return:
+		//false if the file could not be read
+	//note:
+		//the file is left mapped so the spans can be copied. caller unmaps it
+
+	chunks.clear();
+	if (!model.nodeDispFile.Map())
+		return false;
+	const char* data = model.nodeDispFile.mapData;
+	long long size = model.nodeDispFile.mapSize;
+	//skip header:
+	const char* nl = (const char*) memchr(data, '\n', (size_t) size);
+	if (nl == NULL)
+		return true;
+	long long dataStart = nl + 1 - data;
+	long long dataSize = size - dataStart;
+
+	chunks.resize(SRparallel::GetNumChunks(dataSize, DISPCHUNKSIZE));
+	SRbitVector& deckNodes = deckNodeUids;
+	SRparallel::For(dataSize, DISPCHUNKSIZE, [&](int c, long long begin, long long end)
+	{
+		SRdispFileChunk& chunk = chunks[c];
+		chunk.stopped = false;
+		//rows that start in this chunk belong to it:
+		const char* p = data + dataStart + begin;
+		const char* chunkEnd = data + dataStart + end;
+		const char* fileEnd = data + size;
+		if (begin > 0 && p[-1] != '\n')
+		{
+			p = (const char*) memchr(p, '\n', fileEnd - p);
+			if (p == NULL)
+				return;
+			p++;
+		}
+		while (p < chunkEnd)
+		{
+			const char* rowEnd = (const char*) memchr(p, '\n', fileEnd - p);
+			const char* next = (rowEnd == NULL) ? fileEnd : rowEnd + 1;
+			int uid;
+			if (!dispRowRead(p, (rowEnd == NULL) ? fileEnd : rowEnd, uid))
+			{
+				chunk.stopped = true;
 				break;
 			}
+			if (deckNodesOnly)
+			{
+				if (!deckNodes.Get(uid))
+				{
+					//possibly a node on unsupported entity e.g. shell, just skip it:
+					p = next;
+					continue;
+				}
+				long long rowBegin = p - data;
+				long long rowStop = next - data;
+				int nspan = chunk.spans.size();
+				if (nspan > 0 && chunk.spans[nspan - 1] == rowBegin)
+					chunk.spans[nspan - 1] = rowStop;
+				else
+				{
+					chunk.spans.push_back(rowBegin);
+					chunk.spans.push_back(rowStop);
+				}
+			}
+			chunk.uids.push_back(uid);
+			p = next;
 		}
-		if (!anyNodeWithDisp)
+	});
+	return true;
+}
+
+bool SRinput::cropCheckElement(SRstring& line, bool checkLinear)
+{
+	//in counting pass, check if an element card touches a node in the displacement file.
+	//if so, mark all of its nodes to be created in the 2nd pass
+	//input:
+		//line = CHEXA, CPENTA, or CTETRA card
+		//checkLinear = true to check this element for linear mesh
+	//return:
+		//true if the element will be kept in the cropped model
+
+	line.BdfToken();//skip element label field (e.g chexa)
+	line.BdfToken();//skip eluid field
+	line.BdfToken();//skip elpropid field
+	int gid[20];
+	int nnodes = 0;
+	while (nnodes < 20)
+	{
+		if (!line.BdfRead(gid[nnodes]))
+			break;
+		nnodes++;
+	}
+	if (checkLinear)
+	{
+		if (nnodes != 10 && nnodes != 15 && nnodes != 20)
+			model.linearMesh = true;
+	}
+	bool anyNodeWithDisp = false;
+	for (int i = 0; i < nnodes; i++)
+	{
+		if (dispNodeUids.Get(gid[i]))
+		{
+			anyNodeWithDisp = true;
+			break;
+		}
+	}
+	if (!anyNodeWithDisp)
+		return false;
+	for (int i = 0; i < nnodes; i++)
+		cropNodeUids.Set(gid[i]);
+	return true;
+}
+
+bool SRinput::cropBsurfOnlyElements()
+{
+	//remove the elements that were kept only because they are referenced by bsurfs
+	//return:
+		//false if no elements are left, else true
+
+	SRindex numfreed = 0;
+	SRindex nel = model.GetNumElements();
+	for (SRindex e = 0; e < nel; e++)
+	{
+		if (model.GetElement(e)->bsurfOnly)
 		{
 			model.elements.Free(e);
 			numfreed++;
@@ -1350,196 +2315,781 @@ void SRinput::cropElements()
 		//just set elemUidOffSet to -1 to force
 		//bsearch:
 		elemUidOffSet = -1;
+		if (!SortElements())
+			return false;
+		for (SRindex e = 0; e < model.GetNumElements(); e++)
+			model.GetElement(e)->id = e;
 	}
+	return true;
 }
 
+void SRinput::setActiveMaterials()
+{
+	//set the active flag of the materials that are used by elements in the model
+	for (int m = 0; m < model.GetNumMaterials(); m++)
+		model.GetMaterial(m)->active = false;
+	for (SRindex e = 0; e < model.GetNumElements(); e++)
+	{
+		int mid = model.GetElement(e)->matid;
+		model.GetMaterial(mid)->active = true;
+	}
+}
 
-void SRinput::finishForces()
+void SRinput::removeOrphanNodes()
 {
-	int numfreed = 0;
-	for (int f = 0; f < model.forces.GetNum(); f++)
+	//delete nodes that are not used by any element, pack the nodes and resort
+	//note:
+		//the node to element adjacency has to be built, see SetNodeElmentOwners
+	SRindex numNodesTotal = model.GetNumNodes();
+	SRindex numfreed = 0;
+	for (SRindex n = 0; n < numNodesTotal; n++)
+	{
+		if (model.GetNode(n)->isOrphan())
+		{
+			model.nodes.Free(n);
+			numfreed++;
+		}
+	}
+	if (numfreed > 0)
 	{
-		SRforce* force = model.GetForce(f);
-		if (force->type == nodalForce)
+		model.PackNodeElements();
+		model.nodes.packNulls();
+		//packing nodes will mess up nodeuidoffset and throw off searches.
+		//just set nodeUidOffset to -1 to force
+		//bsearch:
+		nodeUidOffset = -1;
+		SortNodes();
+	}
+}
+
+struct SRbvhNode
+{
+	//node of the element bounding volume hierarchy, see SRinput::selectBreakoutElements
+	double lo[3], hi[3]; //bounding box of the elements under the node
+	SRindex first, count; //the elements under the node are order[first] to order[first + count - 1]
+	int left, right; //children, -1 for a leaf
+};
+
+#define BVHLEAFSIZE 8
+
+static int SRbvhBuild(vector <SRbvhNode>& tree, vector <SRindex>& order, SRindex first, SRindex count,
+	vector <double>& boxes)
+{
+	//build the subtree of a bounding volume hierarchy over a range of elements. the range is split at the
+	//median centroid along the longest axis of the centroids' box
+	//input:
+		//order = element numbers
+		//first, count = range of order under the subtree
+		//boxes = bounding box of each element, xmin ymin zmin xmax ymax zmax
+	//output:
+		//tree = subtree nodes added
+		//order = range reordered so the elements of each child are contiguous
+	//return:
+		//position of the subtree root in tree
+
+	int t = (int) tree.size();
+	tree.push_back(SRbvhNode());
+	double clo[3] = { BIG, BIG, BIG };
+	double chi[3] = { -BIG, -BIG, -BIG };
+	SRbvhNode bn;
+	for (int i = 0; i < 3; i++)
+	{
+		bn.lo[i] = BIG;
+		bn.hi[i] = -BIG;
+	}
+	for (SRindex k = first; k < first + count; k++)
+	{
+		double* box = &boxes[6 * order[k]];
+		for (int i = 0; i < 3; i++)
 		{
-			if (force->nv[0] == -1)
+			bn.lo[i] = min(bn.lo[i], box[i]);
+			bn.hi[i] = max(bn.hi[i], box[i + 3]);
+			double c = box[i] + box[i + 3];
+			clo[i] = min(clo[i], c);
+			chi[i] = max(chi[i], c);
+		}
+	}
+	bn.first = first;
+	bn.count = count;
+	bn.left = bn.right = -1;
+	if (count > BVHLEAFSIZE)
+	{
+		int axis = 0;
+		for (int i = 1; i < 3; i++)
+		{
+			if (chi[i] - clo[i] > chi[axis] - clo[axis])
+				axis = i;
+		}
+		SRindex half = count / 2;
+		nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+			[&](SRindex a, SRindex b)
+		{
+			return boxes[6 * a + axis] + boxes[6 * a + axis + 3] < boxes[6 * b + axis] + boxes[6 * b + axis + 3];
+		});
+		bn.left = SRbvhBuild(tree, order, first, half, boxes);
+		bn.right = SRbvhBuild(tree, order, first + half, count - half, boxes);
+	}
+	tree[t] = bn;
+	return t;
+}
+
+void SRinput::selectBreakoutElements()
+{
+	//mark the elements in the breakout region saveForBreakout.
+	//for a box or sphere, an element is in the region if all its nodes are. a bounding volume hierarchy
+	//over the elements is searched so only the elements near the region boundary are checked node by node:
+	//subtrees whose box misses the region are skipped, subtrees whose box is inside it are taken whole
+
+	SRbreakoutRegion& br = model.breakout;
+	SRindex nelem = model.GetNumElements();
+	if (br.type == elemBreakout)
+	{
+		//the uid ranges are sorted and disjoint, see readBreakoutOption:
+		for (SRindex e = 0; e < nelem; e++)
+		{
+			SRelement* elem = model.GetElement(e);
+			int uid = elem->GetUserid();
+			//last range starting at or before uid:
+			vector <pair <int, int> >::iterator it = upper_bound(br.elemUids.begin(), br.elemUids.end(), uid,
+				[](int u, const pair <int, int>& range) { return u < range.first; });
+			if (it != br.elemUids.begin() && uid <= (it - 1)->second)
+				elem->saveForBreakout = true;
+		}
+		return;
+	}
+
+	vector <double> boxes(6 * nelem);
+	SRparallel::For(nelem, FINISHCHUNKSIZE, [&](int c, long long begin, long long end)
+	{
+		for (SRindex e = begin; e < end; e++)
+		{
+			SRelement* elem = model.GetElement(e);
+			double* box = &boxes[6 * e];
+			for (int i = 0; i < 3; i++)
 			{
-				//force
-				int gid = force->entityId;
-				if (model.checkOrphanNode(gid))
-				{
-					model.forces.Free(f);
-					numfreed++;
+				box[i] = BIG;
+				box[i + 3] = -BIG;
+			}
+			for (int n = 0; n < elem->GetNumNodes(); n++)
+			{
+				SRindex nid = NodeLookup(elem->nodeUIds.Get(n));
+				if (nid == -1)
 					continue;
-				}
-				int cid = force->coordId;
-				if (cid > 0)
+				SRvec3& p = model.GetNode(nid)->pos;
+				for (int i = 0; i < 3; i++)
 				{
-					//transform to gcs:
-					SRcoord* coord = model.GetCoord(cid);
-					int nid = NodeFind(gid);
-					SRvec3 f;
-					for (int d = 0; d < 3; d++)
-						f.d[d] = force->forceVals.Get(0, d);
-					coord->VecTransform(model.GetNode(nid)->Position(), f);
-					force->coordId = -1;//already transformed, so set gcs
+					box[i] = min(box[i], p.d[i]);
+					box[i + 3] = max(box[i + 3], p.d[i]);
 				}
 			}
+		}
+	});
+	vector <SRindex> order(nelem);
+	for (SRindex e = 0; e < nelem; e++)
+		order[e] = e;
+	vector <SRbvhNode> tree;
+	tree.reserve(2 * (nelem / BVHLEAFSIZE + 1));
+	SRbvhBuild(tree, order, 0, nelem, boxes);
+
+	bool box = (br.type == boxBreakout);
+	double r2 = br.radius * br.radius;
+	vector <int> stack;
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		SRbvhNode& bn = tree[stack.back()];
+		stack.pop_back();
+		bool overlap = true, inside = true;
+		if (box)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				if (bn.hi[i] < br.p1.d[i] || bn.lo[i] > br.p2.d[i])
+					overlap = false;
+				if (bn.lo[i] < br.p1.d[i] || bn.hi[i] > br.p2.d[i])
+					inside = false;
+			}
+		}
+		else
+		{
+			//nearest and farthest points of the node box from the sphere center:
+			double dnear = 0.0, dfar = 0.0;
+			for (int i = 0; i < 3; i++)
+			{
+				double c = br.p1.d[i];
+				double dn = max(max(bn.lo[i] - c, c - bn.hi[i]), 0.0);
+				double df = max(c - bn.lo[i], bn.hi[i] - c);
+				dnear += dn * dn;
+				dfar += df * df;
+			}
+			overlap = (dnear <= r2);
+			inside = (dfar <= r2);
+		}
+		if (!overlap)
+			continue;
+		if (inside)
+		{
+			for (SRindex k = bn.first; k < bn.first + bn.count; k++)
+				model.GetElement(order[k])->saveForBreakout = true;
+		}
+		else if (bn.left != -1)
+		{
+			stack.push_back(bn.left);
+			stack.push_back(bn.right);
+		}
+		else
+		{
+			for (SRindex k = bn.first; k < bn.first + bn.count; k++)
+			{
+				SRelement* elem = model.GetElement(order[k]);
+				if (box)
+					elem->saveForBreakout = elem->InsideBoundingBox(br.p1.d[0], br.p2.d[0], br.p1.d[1], br.p2.d[1],
+						br.p1.d[2], br.p2.d[2]);
+				else
+					elem->saveForBreakout = elem->nodeDistCheck(br.p1, br.radius);
+			}
+		}
+	}
+}
+
+bool SRinput::breakoutModel()
+{
+	//reduce the model to the elements in the breakout region plus model.breakout.rings rings of
+	//neighboring elements, for local refinement studies. nodes no longer used by an element are deleted.
+	//forces and constraints on deleted nodes and elements are skipped by finishForces and finishConstraints
+	//return:
+		//false if the breakout region has no elements, else true
+	//note:
+		//the node to element adjacency has to be built, see SetNodeElmentOwners
+
+	selectBreakoutElements();
+	SRindex nelem = model.GetNumElements();
+	SRindex nsel = 0;
+	for (SRindex e = 0; e < nelem; e++)
+	{
+		if (model.GetElement(e)->saveForBreakout)
+			nsel++;
+	}
+	LOGPRINT(" breakout: " SRINDEXFMT " of " SRINDEXFMT " elements in region", nsel, nelem);
+	if (nsel == 0)
+		return deckError("breakout", "region has no elements");
+	for (int r = 0; r < model.breakout.rings; r++)
+	{
+		model.FindElemsAdjacentToBreakout();
+		if (model.numbreakoutElems == 0)
+			break;
+		for (int i = 0; i < model.numbreakoutElems; i++)
+			model.GetElement(model.breakoutElems.Get(i))->saveForBreakout = true;
+		nsel += model.numbreakoutElems;
+		LOGPRINT(" breakout: ring %d adds %d elements", r + 1, model.numbreakoutElems);
+	}
+	model.breakoutElems.Free();
+	model.numbreakoutElems = 0;
+
+	//nodes on the cut, used by kept and removed elements:
+	SRindex ncut = 0;
+	for (SRindex n = 0; n < model.GetNumNodes(); n++)
+	{
+		bool kept = false, removed = false;
+		for (SRindex j = 0; j < model.GetNumNodeElements(n); j++)
+		{
+			if (model.GetElement(model.GetNodeElement(n, j))->saveForBreakout)
+				kept = true;
 			else
+				removed = true;
+		}
+		if (kept && removed)
+			ncut++;
+	}
+
+	for (SRindex e = 0; e < nelem; e++)
+	{
+		if (!model.GetElement(e)->saveForBreakout)
+			model.elements.Free(e);
+	}
+	if (nsel < nelem)
+	{
+		model.elements.packNulls();
+		//packing elements will mess up elemUidOffSet and throw off searches.
+		//just set elemUidOffSet to -1 to force
+		//bsearch:
+		elemUidOffSet = -1;
+		if (!SortElements())
+			return false;
+		for (SRindex e = 0; e < model.GetNumElements(); e++)
+			model.GetElement(e)->id = e;
+	}
+	setActiveMaterials();
+	SetNodeElmentOwners();
+	removeOrphanNodes();
+	LOGPRINT(" breakout: " SRINDEXFMT " elements, " SRINDEXFMT " nodes kept, " SRINDEXFMT " nodes on the cut boundary",
+		nsel, model.GetNumNodes(), ncut);
+	return true;
+}
+
+void SRinput::writeSrrDisps()
+{
+	//copy the displacement file rows for nodes in the bdf file to the .srr file so engine can read the disps.
+	//rows are copied unchanged, in runs of consecutive accepted rows.
+	//mark the nodes that are still in the model "hasDisp".
+	//note:
+		//model.partialDispFile is set if the displacement file does not have a row for every node in the bdf file
+
+	model.srrFile.Open(SRoutputMode);
+	model.srrFile.PrintLine("displacements");
+	vector <SRdispFileChunk> chunks;
+	scanDispFile(true, chunks);
+	const char* data = model.nodeDispFile.mapData;
+	SRindex numNodeDispsRead = 0;
+	long long lastEnd = 0;
+	for (int c = 0; c < (int) chunks.size(); c++)
+	{
+		SRdispFileChunk& chunk = chunks[c];
+		for (int s = 0; s < (int) chunk.spans.size(); s += 2)
+		{
+			model.srrFile.WriteBytes(data + chunk.spans[s], chunk.spans[s + 1] - chunk.spans[s]);
+			lastEnd = chunk.spans[s + 1];
+		}
+		for (int i = 0; i < (int) chunk.uids.size(); i++)
+		{
+			SRindex nid = NodeFind(chunk.uids[i]);
+			if (nid != -1)
+				model.GetNode(nid)->hasDisp = true;
+		}
+		numNodeDispsRead += chunk.uids.size();
+		if (chunk.stopped)
+			break;
+	}
+	//last row may not have a line end:
+	if (lastEnd > 0 && data[lastEnd - 1] != '\n')
+		model.srrFile.PrintReturn();
+	model.srrFile.Close();
+	if (numNodeDispsRead < nnode)
+		model.partialDispFile = true;
+	model.nodeDispFile.Unmap();
+}
+
+
+void SRinput::transformLcsNodes()
+{
+	//transform the positions of nodes that were input in local coordinate systems (GRID CP) to gcs.
+	//the nodes are grouped by coordinate system, then each group is transformed as a batch by
+	//SRcoord::GetPositions, in parallel
+
+	SRindex n = lcsNodes.size();
+	if (n == 0)
+		return;
+	int ncoord = model.Coords.GetNum();
+	//group by coordinate system, keeping input order within each group:
+	vector <SRindex> start(ncoord + 1, 0);
+	for (SRindex i = 0; i < n; i++)
+		start[lcsNodeCoords[i] + 1]++;
+	for (int c = 0; c < ncoord; c++)
+		start[c + 1] += start[c];
+	vector <SRindex> next(start.begin(), start.end() - 1);
+	vector <SRindex> order(n);
+	for (SRindex i = 0; i < n; i++)
+	{
+		int c = lcsNodeCoords[i];
+		order[next[c]] = lcsNodes[i];
+		next[c]++;
+	}
+	vector <double> x(n), y(n), z(n);
+	for (SRindex k = 0; k < n; k++)
+	{
+		SRnode* node = model.GetNode(order[k]);
+		x[k] = node->pos.d[0];
+		y[k] = node->pos.d[1];
+		z[k] = node->pos.d[2];
+	}
+	//detect the instruction set before the parallel loop:
+	SRmachDep::cpuHasAvx2();
+	for (int c = 0; c < ncoord; c++)
+	{
+		SRindex s = start[c];
+		SRindex num = start[c + 1] - s;
+		if (num == 0)
+			continue;
+		SRcoord* coord = model.GetCoord(c);
+		SRparallel::For(num, FINISHCHUNKSIZE, [&](int t, long long begin, long long end)
+		{
+			coord->GetPositions(end - begin, &x[s + begin], &y[s + begin], &z[s + begin]);
+		});
+	}
+	for (SRindex k = 0; k < n; k++)
+		model.GetNode(order[k])->pos.Assign(x[k], y[k], z[k]);
+	lcsNodes.clear();
+	lcsNodes.shrink_to_fit();
+	lcsNodeCoords.clear();
+	lcsNodeCoords.shrink_to_fit();
+}
+
+template <class T> static SRindex packRejected(SRpointerVector <T>& v, vector <char>& keep)
+{
+	//free the entries of v that are not flagged in keep and pack the rest, keeping their order
+	//return:
+		//number of entries freed
+	SRindex numfreed = 0;
+	for (SRindex i = 0; i < (SRindex) keep.size(); i++)
+	{
+		if (!keep[i])
+		{
+			v.Free(i);
+			numfreed++;
+		}
+	}
+	if (numfreed > 0)
+		v.packNulls();
+	return numfreed;
+}
+
+bool SRinput::finishForces()
+{
+	//resolve forces to nodes and element faces and transform them to gcs.
+	//each force is independent, so they are done in parallel; rejected forces are flagged, then
+	//freed and packed serially so the order of forces doesn't depend on the number of threads
+	//return:
+		//false if a force is applied at the origin of its cylindrical or spherical system and
+		//the translation stops, see checkCardErrors. else true
+	SRindex nforce = model.forces.GetNum();
+	vector <char> keep(nforce);
+	vector <char> badCoord(nforce);
+	SRparallel::For(nforce, FINISHCHUNKSIZE, [&](int c, long long begin, long long end)
+	{
+		for (SRindex f = begin; f < end; f++)
+		{
+			bool bad;
+			keep[f] = finishForce(model.GetForce(f), bad);
+			badCoord[f] = bad;
+		}
+	});
+	//card errors are recorded serially, in the order of the forces:
+	for (SRindex f = 0; f < nforce; f++)
+	{
+		if (!badCoord[f])
+			continue;
+		SRforce* force = model.GetForce(f);
+		char reason[100];
+		int cuid = model.GetCoord(force->coordId)->uid;
+		if (force->type == faceForce)
+			SPRINTF(reason, "element %d: a face node is at the origin of coordinate system %d", force->entityId, cuid);
+		else
+			SPRINTF(reason, "node %d is at the origin of coordinate system %d", force->entityId, cuid);
+		addCardError(force->type == faceForce ? "PLOAD4" : "FORCE", 0, reason);
+	}
+	if (stats.on)
+	{
+		for (SRindex f = 0; f < nforce; f++)
+		{
+			if (keep[f])
+				continue;
+			SRforce* force = model.GetForce(f);
+			if (force->type == faceForce)
+				stats.Get("PLOAD4").rejected++;
+			else if (force->nv[0] != -1)
+				stats.Get("FORCE1").rejected++;
+			else
+				stats.Get("FORCE").rejected++;
+		}
+	}
+	packRejected(model.forces, keep);
+	return checkCardErrors();
+}
+
+bool SRinput::finishForce(SRforce* force, bool& badCoord)
+{
+	//resolve a force to its nodes or element face and transform it to gcs
+	//input:
+		//force = force to resolve
+	//output:
+		//badCoord = true if the force's coordinate system has no direction at a node it is applied to,
+		//i.e. the node is at the origin of a cylindrical or spherical system
+	//note:
+		//called from parallel loops, so it uses the uncached lookups NodeLookup, ElemLookup and isOrphanNode
+	//return:
+		//false if the force refers to nodes or elements not in the model or badCoord is set, else true
+
+	badCoord = false;
+	if (force->type == nodalForce)
+	{
+		if (force->nv[0] == -1)
+		{
+			//force
+			int gid = force->entityId;
+			if (isOrphanNode(gid))
+				return false;
+			int cid = force->coordId;
+			if (cid != -1)
 			{
-				//force1
-				int guid1 = force->nv[0];
-				int guid2 = force->nv[1];
-				if (model.checkOrphanNode(guid1) || model.checkOrphanNode(guid2))
+				//transform to gcs:
+				SRcoord* coord = model.GetCoord(cid);
+				SRindex nid = NodeLookup(gid);
+				SRvec3 f;
+				for (int d = 0; d < 3; d++)
+					f.d[d] = force->forceVals.Get(0, d);
+				if (!coord->VecTransform(model.GetNode(nid)->Position(), f))
 				{
-					//force refers to nodes not in mesh, may have been cropped. skip it
-					model.forces.Free(f);
-					numfreed++;
-					continue;
+					badCoord = true;
+					return false;
 				}
-				int g1 = NodeFind(guid1);
-				int g2 = NodeFind(guid2);
-				double magIn = force->forceVals.Get(0, 0);
-				force->forceVals.Free();
-				SRvec3 p1;
-				p1.Copy(model.GetNode(g1)->pos);
-				SRvec3 f;
-				f.Copy(model.GetNode(g2)->pos);
-				f.MinusAssign(p1);
-				f.Normalize();
-				f.Scale(magIn);
-				force->forceVals.Allocate(1, 3);
-				force->forceVals.Put(0, 0, f.d[0]);
-				force->forceVals.Put(0, 1, f.d[1]);
-				force->forceVals.Put(0, 2, f.d[2]);
+				for (int d = 0; d < 3; d++)
+					force->forceVals.Put(0, d, f.d[d]);
+				force->coordId = -1;//already transformed, so set gcs
 			}
 		}
 		else
 		{
-			//face force
-			int eluid = force->entityId;
-			int eid = ElemFind(eluid);
-			if (eid == -1)
+			//force1
+			int guid1 = force->nv[0];
+			int guid2 = force->nv[1];
+			if (isOrphanNode(guid1) || isOrphanNode(guid2))
 			{
-				//element may have been cropped or is a shell. skip the force
-				model.forces.Free(f);
-				numfreed++;
-				continue;
-
+				//force refers to nodes not in mesh, may have been cropped. skip it
+				return false;
 			}
-			SRelement* elem = model.GetElement(eid);
-			int g1,g2, gout[8];
+			SRindex g1 = NodeLookup(guid1);
+			SRindex g2 = NodeLookup(guid2);
+			double magIn = force->forceVals.Get(0, 0);
+			force->forceVals.Free();
+			SRvec3 p1;
+			p1.Copy(model.GetNode(g1)->pos);
+			SRvec3 f;
+			f.Copy(model.GetNode(g2)->pos);
+			f.MinusAssign(p1);
+			f.Normalize();
+			f.Scale(magIn);
+			force->forceVals.Allocate(1, 3);
+			force->forceVals.Put(0, 0, f.d[0]);
+			force->forceVals.Put(0, 1, f.d[1]);
+			force->forceVals.Put(0, 2, f.d[2]);
+		}
+	}
+	else
+	{
+		//face force
+		int eluid = force->entityId;
+		SRindex eid = ElemLookup(eluid);
+		if (eid == -1)
+		{
+			//element may have been cropped or is a shell. skip the force
+			return false;
+		}
+		SRelement* elem = model.GetElement(eid);
+		int g1,g2, gout[8];
+
+		g1 = force->nv[0];
+		g2 = force->nv[1];
+		int ncorner = findElemFace(false, elem, g1, g2, gout);
+		if (ncorner == -1)
+		{
+			//force refers to element nodes not in mesh, may have been cropped. skip it
+			return false;
+		}
 
-			g1 = force->nv[0];
-			g2 = force->nv[1];
-			int ncorner = findElemFace(false, elem, g1, g2, gout);
-			if (ncorner == -1)
+		double pv[4];
+		for (int n = 0; n < 4; n++)
+			pv[n] = force->forceVals.Get(n, 0);
+		if (force->pressure)
+		{
+			//ttd remove this limitation: pass the info to engine and let it handle it.
+			//can't support variable pload4 unless bring in edge, face, and mapping.
+			//see spec, pvs are assigned by using rh rule and outward normal to element
+			//check for constant:
+			double fp0 = fabs(pv[0]);
+			for (int i = 0; i < ncorner; i++)
 			{
-				//force refers to element nodes not in mesh, may have been cropped. skip it
-				model.forces.Free(f);
-				numfreed++;
-				continue;
+				double diff = fabs(pv[i] - pv[0]);
+				if (diff > fp0*RELSMALL)
+					return false; //ttd warning
 			}
-
-			double pv[4];
-			for (int n = 0; n < 4; n++)
-				pv[n] = force->forceVals.Get(n, 0);
-			if (force->pressure)
+			for (int i = 0; i < ncorner; i++)
+				force->nv[i] = gout[i];
+			if (ncorner == 3)
+				force->nv[3] = -1;
+			force->forceVals.Allocate(ncorner, 1);
+			for (int i = 0; i < ncorner; i++)
+				force->forceVals.Put(i, 0, pv[i]);
+		}
+		else
+		{
+			force->pressure = false;
+			SRvec3 nv;
+			nv.d[0] = force->forceVals.Get(0, 1);
+			nv.d[1] = force->forceVals.Get(1, 1);
+			nv.d[2] = force->forceVals.Get(2, 1);
+			force->forceVals.Free();
+			force->forceVals.Allocate(ncorner, 3);
+			for (int i = 0; i < ncorner; i++)
 			{
-				//ttd remove this limitation: pass the info to engine and let it handle it.
-				//can't support variable pload4 unless bring in edge, face, and mapping.
-				//see spec, pvs are assigned by using rh rule and outward normal to element
-				//check for constant:
-				double fp0 = fabs(pv[0]);
-				for (int i = 0; i < ncorner; i++)
+				//use coordid to rotate N if nec
+				if (force->coordId != -1)
 				{
-					double diff = fabs(pv[i] - pv[0]);
-					if (diff > fp0*RELSMALL)
+					SRcoord* coord = model.GetCoord(force->coordId);
+					if (isOrphanNode(gout[i]))
+					{
+						//force refers to node not found in model, skip it:
+						return false;
+					}
+					SRindex nodeid = NodeLookup(gout[i]);
+					SRvec3 p = model.GetNode(nodeid)->Position();
+					if (!coord->VecTransform(p, nv))
 					{
-						model.forces.Free(f);
-						numfreed++;
-						continue;
-						//ttd warning
+						badCoord = true;
+						return false;
 					}
+					force->coordId = -1;//already transformed so set as gcs
 				}
-				for (int i = 0; i < ncorner; i++)
-					force->nv[i] = gout[i];
-				if (ncorner == 3)
-					force->nv[3] = -1;
-				force->forceVals.Allocate(ncorner, 1);
-				for (int i = 0; i < ncorner; i++)
-					force->forceVals.Put(i, 0, pv[i]);
+				SRvec3 t = nv;
+				t.Normalize();
+				t.Scale(pv[i]);
+				for (int dof = 0; dof < 3; dof++)
+					force->forceVals.Put(i, dof, t.d[dof]);
+			}
+			for (int i = 0; i < ncorner; i++)
+				force->nv[i] = gout[i];
+			if (ncorner == 3)
+				force->nv[3] = -1;
+		}
+	}
+	return true;
+}
+
+bool SRinput::finishVolumeForces()
+{
+	//transform volume forces defined in local systems to gcs, and
+	//fill in the origins of centrifugal forces from their origin nodes.
+	//skip forces that refer to nodes not found in model
+	//return:
+		//false if a force is in a cylindrical or spherical system, which has no direction at its origin,
+		//and the translation stops, see checkCardErrors. else true
+
+	SRindex numfreed = 0;
+	for (SRindex v = 0; v < model.volumeForces.GetNum(); v++)
+	{
+		SRvolumeForce* vol = model.volumeForces.GetPointer(v);
+		if (vol->coordId != -1)
+		{
+			//transform gravity vector or rotation axis to gcs:
+			SRcoord* coord = model.GetCoord(vol->coordId);
+			SRvec3 p = coord->origin;
+			bool transformed;
+			if (vol->type == gravity)
+			{
+				SRvec3 f;
+				f.Assign(vol->g1, vol->g2, vol->g3);
+				transformed = coord->VecTransform(p, f);
+				vol->g1 = f.d[0];
+				vol->g2 = f.d[1];
+				vol->g3 = f.d[2];
 			}
 			else
+				transformed = coord->VecTransform(p, vol->axis);
+			if (!transformed)
 			{
-				force->pressure = false;
-				SRvec3 nv;
-				nv.d[0] = force->forceVals.Get(0, 1);
-				nv.d[1] = force->forceVals.Get(1, 1);
-				force->forceVals.Free();
-				force->forceVals.Allocate(ncorner, 3);
-				for (int i = 0; i < ncorner; i++)
-				{
-					//use coordid to rotate N if nec
-					if (force->coordId != -1)
-					{
-						SRcoord* coord = model.GetCoord(force->coordId);
-						if (model.checkOrphanNode(gout[i]))
-						{
-							//force refers to node not found in model, skip it:
-							model.forces.Free(f);
-							numfreed++;
-							continue;
-						}
-						int nodeid = NodeFind(gout[i]);
-						SRvec3 p = model.GetNode(nodeid)->Position();
-						coord->VecTransform(p, nv);
-						force->coordId = -1;//already transformed so set as gcs
-					}
-					nv.Normalize();
-					nv.Scale(pv[i]);
-					for (int dof = 0; dof < 3; dof++)
-						force->forceVals.Put(i, dof, nv.d[dof]);
-				}
+				char reason[100];
+				SPRINTF(reason, "coordinate system %d has no direction at its origin", coord->uid);
+				addCardError(vol->type == gravity ? "GRAV" : "RFORCE", 0, reason);
+				model.volumeForces.Free(v);
+				numfreed++;
+				continue;
 			}
+			vol->coordId = -1;
+		}
+		if (vol->type != centrifugal || vol->originGid == -1)
+			continue;
+		SRindex nid = NodeFind(vol->originGid);
+		if (nid == -1)
+		{
+			model.volumeForces.Free(v);
+			numfreed++;
+			continue;
 		}
+		vol->origin.Copy(model.GetNode(nid)->pos);
+		vol->axis.PlusAssign(vol->origin);
+		vol->originGid = -1;
 	}
 	if (numfreed > 0)
-		model.forces.packNulls();
+		model.volumeForces.packNulls();
+	return checkCardErrors();
+}
+
+void SRinput::finishTemps()
+{
+	//apply TEMP cards to their nodes, after the nodes are sorted.
+	//skip temperatures that refer to nodes not found in model (e.g. cropped).
+	//with more than one subcase each subcase selects its own TEMP set, so the cards are kept
+	//for SRoutput::SelectSubcase; else they are freed once applied
+	if (model.isMultiSubcase())
+		return;
+	for (SRindex t = 0; t < model.temps.GetNum(); t++)
+	{
+		SRnodeTemp* temp = model.temps.GetPointer(t);
+		SRindex nid = NodeFind(temp->nodeUid);
+		if (nid == -1)
+			continue;
+		SRnode* node = model.GetNode(nid);
+		node->hasTemp = true;
+		node->Temp = temp->T;
+	}
+	model.temps.Free();
 }
 
 void SRinput::finishConstraints()
 {
-	int numfreed = 0;
-	for (int c = 0; c < model.GetNumConstraints(); c++)
+	//drop constraints on nodes not in the model and check their local coordinate systems, in parallel.
+	//then attach the remaining constraints to their nodes, in order, after packing so the node's
+	//constraintId is the constraint's final position
+	SRindex ncon = model.GetNumConstraints();
+	vector <char> keep(ncon);
+	SRparallel::For(ncon, FINISHCHUNKSIZE, [&](int t, long long begin, long long end)
+	{
+		for (SRindex c = begin; c < end; c++)
+		{
+			SRconstraint* con = model.GetConstraint(c);
+			int gid = con->entityId;
+			//constraint may refer to node not in model. may have been cropped
+			keep[c] = !isOrphanNode(gid);
+			if (!keep[c])
+				continue;
+			SRnode* node = model.GetNode(NodeLookup(gid));
+			//check for coordid associated to node:
+			checkLcs(con, node->dispCoordid);
+		}
+	});
+	if (stats.on)
 	{
-		SRconstraint* con = model.GetConstraint(c);
-		int gid = con->entityId;
-		if (model.checkOrphanNode(gid))
+		for (SRindex c = 0; c < ncon; c++)
 		{
-			//constraint refers to node not in model. may have been cropped
-			model.constraints.Free(c);
-			numfreed++;
-			continue;
+			const char* card = model.GetConstraint(c)->card;
+			if (!keep[c] && card != NULL)
+				stats.Get(card).rejected++;
 		}
-		int nid = NodeFind(gid);
-		SRnode* node = model.GetNode(nid);
+	}
+	packRejected(model.constraints, keep);
+	for (SRindex c = 0; c < model.GetNumConstraints(); c++)
+	{
+		SRconstraint* con = model.GetConstraint(c);
+		SRnode* node = model.GetNode(NodeFind(con->entityId));
 		node->constraintId = c;
-		//check for coordid associated to node:
-		checkLcs(con, node->dispCoordid);
 	}
-	for (int e = 0; e < model.enfds.GetNum(); e++)
+	if (model.isMultiSubcase())
+	{
+		//SPCD sets are selected by the subcase loads, so they are applied for each subcase on output.
+		//see SRoutput::SelectSubcase
+		return;
+	}
+	for (SRindex e = 0; e < model.enfds.GetNum(); e++)
 	{
 		SRenfd *enfd = model.enfds.GetPointer(e);
 		int gid = enfd->nuid;
-		int nid = NodeFind(gid);
+		SRindex nid = NodeFind(gid);
 		//constraint refers to node not in model. may have been cropped
 		if (nid == -1)
 			continue;
 		SRnode* node = model.GetNode(nid);
 		if (node == NULL)
 			continue;
-		int cid = node->constraintId;
+		SRindex cid = node->constraintId;
 		if (cid == -1)
 			continue; //enfd is applied to unconstrained node
 		SRconstraint* con = model.GetConstraint(cid);
@@ -1554,76 +3104,142 @@ void SRinput::finishConstraints()
 		}
 	}
 	model.enfds.Free();
-	if (numfreed > 0)
-		model.constraints.packNulls();
 }
 
-void SRinput::finishUnsup()
+struct SRunsupChunk
 {
-	for (int u = 0; u < model.unsups.GetNum(); u++)
+	//nodes of the unsupported entities in one chunk of finishUnsup, in order:
+	vector <SRindex> nids;
+	vector <int> counts; //number of nids of each entity
+	vector <SRindex> bad; //entities that could not be finished
+	vector <int> badUids; //element not found for each entity in bad
+};
+
+bool SRinput::finishUnsup()
+{
+	//mark nodes of unsupported entities (shells, beams, bsurfs, ...).
+	//the nodes of each entity are looked up in parallel into per-chunk lists. the flags are then applied
+	//serially in entity order because whether a node is marked general unsupported depends on the
+	//marks made before it
+	//return:
+		//false if the translation has to stop because of card errors, see checkCardErrors
+	SRindex nunsup = model.unsups.GetNum();
+	vector <SRunsupChunk> chunks(SRparallel::GetNumChunks(nunsup, FINISHCHUNKSIZE));
+	SRparallel::For(nunsup, FINISHCHUNKSIZE, [&](int c, long long begin, long long end)
+	{
+		SRunsupChunk& chunk = chunks[c];
+		for (SRindex u = begin; u < end; u++)
+		{
+			SRindex n0 = chunk.nids.size();
+			int badUid;
+			if (!finishUnsupNodes(model.unsups.GetPointer(u), chunk.nids, badUid))
+			{
+				//the entity is skipped:
+				chunk.nids.resize(n0);
+				chunk.bad.push_back(u);
+				chunk.badUids.push_back(badUid);
+			}
+			chunk.counts.push_back((int) (chunk.nids.size() - n0));
+		}
+	});
+	for (int c = 0; c < (int) chunks.size(); c++)
 	{
-		SRunsup *unsup = model.unsups.GetPointer(u);
-		int nnodes = unsup->gids.GetNum();
-		if (unsup->isBsurf)
+		SRunsupChunk& chunk = chunks[c];
+		for (int b = 0; b < (int) chunk.bad.size(); b++)
 		{
-			int nread = 0;
-			int gidFace[4];
-			while (1)
+			char reason[100];
+			SPRINTF(reason, "element %d not found", chunk.badUids[b]);
+			addCardError("BSURFS", model.unsups.GetPointer(chunk.bad[b])->cardLine, reason);
+		}
+	}
+	if (!checkCardErrors())
+		return false;
+
+	SRindex u = 0;
+	for (int c = 0; c < (int) chunks.size(); c++)
+	{
+		SRunsupChunk& chunk = chunks[c];
+		SRindex k = 0;
+		for (int j = 0; j < (int) chunk.counts.size(); j++, u++)
+		{
+			SRunsup *unsup = model.unsups.GetPointer(u);
+			for (int i = 0; i < chunk.counts[j]; i++, k++)
 			{
-				int eluid = unsup->gids.Get(nread);
-				nread++;
-				int eid = ElemFind(eluid);
-				if (eid != -1)
+				SRnode* node = model.GetNode(chunk.nids[k]);
+				if (unsup->isBsurf)
+					node->bsurf = true;
+				else if (unsup->isShellOrBeam)
 				{
-					SRelement* elem = model.GetElement(eid);
-					int nfaceGids = findFaceNodes(elem, unsup->gids.d, nread, gidFace);
-					for (int n = 0; n < nfaceGids; n++)
+					node->shellOrBeamNode = true;
+					model.anyShellOrBeamNode = true;
+				}
+				else
+				{
+					//mark general unsupported, only if it's not already a shell or beam node or a bsurf node
+					//(they take precedence);
+					if (!node->bsurf && !node->shellOrBeamNode)
 					{
-						int nid = NodeFind(gidFace[n]);
-						//some entities refer to scalar points not grid points, so nid will come up -1:
-						if (nid != -1)
-						{
-							SRnode* node = model.GetNode(nid);
-							node->bsurf = true;
-						}
+						node->unSupported = true;
+						model.anyGeneralUnsupportedNode = true;
 					}
-					if (nread >= nnodes)
-						break;
 				}
-				else
-					ERROREXIT;
 			}
 		}
-		else
+	}
+	model.unsups.Free();
+	return true;
+}
+
+bool SRinput::finishUnsupNodes(SRunsup* unsup, vector <SRindex>& nids, int& badUid)
+{
+	//look up the nodes of an unsupported entity
+	//note:
+		//called from parallel loops, so it uses the uncached lookups NodeLookup and ElemLookup
+	//output:
+		//nids = node numbers of the entity are appended. for a bsurf, the nodes of its element faces
+		//badUid = the element not found if false is returned
+	//return:
+		//false if a bsurf refers to an element not in the model, else true
+	int nnodes = unsup->gids.GetNum();
+	if (unsup->isBsurf)
+	{
+		int nread = 0;
+		int gidFace[4];
+		while (1)
 		{
-			for (int i = 0; i < nnodes; i++)
+			int eluid = unsup->gids.Get(nread);
+			nread++;
+			SRindex eid = ElemLookup(eluid);
+			if (eid == -1)
 			{
-				int gid = unsup->gids.Get(i);
-				int nid = NodeFind(gid);
+				badUid = eluid;
+				return false;
+			}
+			SRelement* elem = model.GetElement(eid);
+			int nfaceGids = findFaceNodes(elem, unsup->gids.d, nread, gidFace);
+			for (int n = 0; n < nfaceGids; n++)
+			{
+				SRindex nid = NodeLookup(gidFace[n]);
 				//some entities refer to scalar points not grid points, so nid will come up -1:
 				if (nid != -1)
-				{
-					SRnode* node = model.GetNode(nid);
-					if (unsup->isShellOrBeam)
-					{
-						node->shellOrBeamNode = true;
-						model.anyShellOrBeamNode = true;
-					}
-					else
-					{
-						//mark general unsupported, only if it's not already a shell or beam node or a bsurf node
-						//(they take precedence);
-						if (!node->bsurf && !node->shellOrBeamNode)
-						{
-							node->unSupported = true;
-							model.anyGeneralUnsupportedNode = true;
-						}
-					}
-				}
+					nids.push_back(nid);
 			}
+			if (nread >= nnodes)
+				break;
 		}
 	}
-	model.unsups.Free();
+	else
+	{
+		for (int i = 0; i < nnodes; i++)
+		{
+			int gid = unsup->gids.Get(i);
+			SRindex nid = NodeLookup(gid);
+			//some entities refer to scalar points not grid points, so nid will come up -1:
+			if (nid != -1)
+				nids.push_back(nid);
+		}
+	}
+	return true;
 }
 
 
@@ -0,0 +1,429 @@
+/*
+Copyright (c) 2020 Richard King
+
+BdfTranslate is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+BdfTranslate is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+The terms of the GNU General Public License are explained in the file COPYING.txt,
+also available at <https://www.gnu.org/licenses/>
+*/
+
+
+// SRbench.cpp : entry point of bdfBench, microbenchmarks of the bdf parsing and .msh output primitives.
+//
+// usage: bdfBench [reps] [nodes]
+	//reps = timed repetitions of each benchmark, default 15
+	//nodes = number of nodes in the generated model, default 200000. there are nodes/8 elements
+//each benchmark runs once untimed, then reps times. the ns per operation of each repetition are
+//summarized as min, median, mean and relative standard deviation.
+//before the benchmarks, SRcoord::GetPositions is checked against GetPos, see checkPositions.
+//exit status is 1 if that check fails, else 0
+
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include "SRmodel.h"
+#include "SRparallel.h"
+
+using namespace std;
+
+//One global instance of "model";
+SRmodel model;
+
+#ifdef linux
+#define NULLDEVICE "/dev/null"
+#else
+#define NULLDEVICE "NUL"
+#endif
+
+static volatile long long benchSink; //results of the benchmarked calls go here so they aren't optimized out
+
+static void runBench(const char* name, long long ops, int reps, function<void()> setup, function<void()> body)
+{
+	//time a benchmark and print its ns per operation
+	//input:
+		//name = benchmark name
+		//ops = operations done by one call of body
+		//reps = timed repetitions
+		//setup = called before each repetition, not timed. may be NULL
+		//body = the operations to time
+	vector <double> ns;
+	for (int r = 0; r <= reps; r++)
+	{
+		if (setup)
+			setup();
+		chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+		body();
+		chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+		if (r == 0)
+			continue; //warm up
+		ns.push_back(chrono::duration<double, nano>(t1 - t0).count() / ops);
+	}
+	sort(ns.begin(), ns.end());
+	double mean = 0.0;
+	for (size_t i = 0; i < ns.size(); i++)
+		mean += ns[i];
+	mean /= ns.size();
+	double var = 0.0;
+	for (size_t i = 0; i < ns.size(); i++)
+		var += (ns[i] - mean) * (ns[i] - mean);
+	double sd = ns.size() > 1 ? sqrt(var / (ns.size() - 1)) : 0.0;
+	double median = ns[ns.size() / 2];
+	if (ns.size() % 2 == 0)
+		median = 0.5 * (ns[ns.size() / 2 - 1] + median);
+	SCREENPRINT("%-28s %12lld %10.2f %10.2f %10.2f %8.1f%%\n", name, ops, ns[0], median, mean, mean > 0.0 ? 100.0 * sd / mean : 0.0);
+}
+
+static unsigned benchRandom(unsigned& seed)
+{
+	//linear congruential generator, so every run makes the same sequence
+	seed = seed * 1664525u + 1013904223u;
+	return seed >> 8;
+}
+
+static double benchUniform(unsigned& seed, double lo, double hi)
+{
+	//uniform random number in [lo, hi), see benchRandom
+	return lo + (hi - lo) * (benchRandom(seed) / 16777216.0);
+}
+
+#define COORDCHECKTOL 1.0e-12 //largest difference of GetPositions from GetPos, relative to the size of the point
+
+static bool checkPositions(int npoints)
+{
+	//check that SRcoord::GetPositions, which transforms 4 points at a time with AVX2 when the processor
+	//has it, gives the same gcs positions as GetPos within COORDCHECKTOL, for each type of coordinate system,
+	//aligned with gcs and rotated
+	//input:
+		//npoints = random points per coordinate system. angles are mostly in [-10, 10] radians; every 16th
+		//          point is on an axis (a multiple of pi/2), every 64th has an angle too large for the AVX2 cosine
+	//return:
+		//false if any point differs by more than the tolerance, else true
+	//note:
+		//GetPos takes the sine as sqrt(1 - cos^2), so an angle within about 1e-7 of a multiple of pi amplifies
+		//a last place difference of the cosines. the random angles are not that close
+	SCREENPRINT("GetPositions check: %d points per system, AVX2 %s, tolerance %lg\n", npoints,
+		SRmachDep::cpuHasAvx2() ? "used" : "not available", COORDCHECKTOL);
+	const SRcoordType types[3] = { cartesian, cylindrical, spherical };
+	const char* typeNames[3] = { "cartesian", "cylindrical", "spherical" };
+	unsigned seed = 2024;
+	bool ok = true;
+	for (int t = 0; t < 3; t++)
+	{
+		for (int rotated = 0; rotated < 2; rotated++)
+		{
+			SRcoord coord;
+			SRvec3 a, b, c;
+			a.Assign(1.5, -2.0, 0.75);
+			if (rotated)
+			{
+				b.Assign(2.0, -1.0, 2.5);
+				c.Assign(3.0, -2.5, 1.0);
+			}
+			else
+			{
+				b.Assign(1.5, -2.0, 1.75);
+				c.Assign(2.5, -2.0, 0.75);
+			}
+			coord.CreateFromPoints(a, b, c);
+			coord.type = types[t];
+			vector <double> x(npoints), y(npoints), z(npoints);
+			for (int i = 0; i < npoints; i++)
+			{
+				x[i] = benchUniform(seed, 0.0, 100.0);
+				y[i] = benchUniform(seed, -10.0, 10.0);
+				z[i] = benchUniform(seed, -10.0, 10.0);
+				if (i % 16 == 5)
+					y[i] = 0.5 * PI * (int) benchUniform(seed, -8.0, 8.0);
+				if (i % 64 == 9)
+					z[i] = benchUniform(seed, 1.0e5, 1.0e6);
+			}
+			vector <double> gx(x), gy(y), gz(z);
+			coord.GetPositions(npoints, &gx[0], &gy[0], &gz[0]);
+			double maxDiff = 0.0;
+			int worst = 0;
+			for (int i = 0; i < npoints; i++)
+			{
+				SRvec3 pos;
+				coord.GetPos(x[i], y[i], z[i], pos);
+				double scale = 1.0 + fabs(x[i]) + coord.origin.Length();
+				double diff = (fabs(gx[i] - pos.d[0]) + fabs(gy[i] - pos.d[1]) + fabs(gz[i] - pos.d[2])) / scale;
+				if (diff > maxDiff || diff != diff)
+				{
+					maxDiff = diff;
+					worst = i;
+				}
+			}
+			bool pass = maxDiff <= COORDCHECKTOL;
+			SCREENPRINT("  %-12s %-8s max relative difference %lg%s\n", typeNames[t], rotated ? "rotated" : "aligned",
+				maxDiff, pass ? "" : " FAILED");
+			if (!pass)
+			{
+				SCREENPRINT("    at lcs point %.17lg %.17lg %.17lg\n", x[worst], y[worst], z[worst]);
+				ok = false;
+			}
+		}
+	}
+	return ok;
+}
+
+static void makeBdf(int nnodes, string& bdf)
+{
+	//generate small field GRID and CHEXA cards. every 4th GRID has Nastran exponents without 'E',
+	//every CHEXA has a continuation line
+	//input:
+		//nnodes = number of GRID cards
+	//output:
+		//bdf = the cards
+	char buf[256];
+	for (int i = 0; i < nnodes; i++)
+	{
+		if (i % 4 == 0)
+			SPRINTF(buf, "GRID    %-8d        %-8.4g%-8.4g%d.25-3  \n", i + 1, 0.5 * (i % 100), 0.25 * (i % 37), i % 9);
+		else
+			SPRINTF(buf, "GRID    %-8d        %-8.4g%-8.4g%-8.4g\n", i + 1, 0.5 * (i % 100), 0.25 * (i % 37), 0.125 * (i % 53));
+		bdf += buf;
+	}
+	for (int e = 0; e < nnodes / 8; e++)
+	{
+		int g = 8 * e + 1;
+		SPRINTF(buf, "CHEXA   %-8d1       %-8d%-8d%-8d%-8d%-8d%-8d+E%-6d\n+E%-6d%-8d%-8d\n", e + 1,
+			g, g + 1, g + 2, g + 3, g + 4, g + 5, e, e, g + 6, g + 7);
+		bdf += buf;
+	}
+	bdf += "ENDDATA\n";
+}
+
+static void makeNodes(int nnodes, int stride)
+{
+	//fill model.nodes, all owned by an element so none are orphans
+	//input:
+		//nnodes = number of nodes
+		//stride = difference between consecutive user ids. 1 for contiguous ids, using SRinput::nodeUidOffset,
+		//         else the ids are found by binary search in SRinput::nodeUids
+	model.nodes.Free();
+	model.nodes.Allocate(nnodes);
+	for (int i = 0; i < nnodes; i++)
+	{
+		SRnode* node = model.nodes.Add();
+		node->Create(1 + i * stride, 0.5 * (i % 100), 0.25 * (i % 37), 0.125 * (i % 53));
+		node->firstElementOwner = 0;
+	}
+	model.input.nodeUids.Free();
+	model.input.lastNodeUid = -1;
+	model.input.lastNodeId = -1;
+	if (stride == 1)
+		model.input.nodeUidOffset = 1;
+	else
+	{
+		model.input.nodeUidOffset = -1;
+		model.input.SortNodes();
+	}
+}
+
+static void makeElements(int nelem)
+{
+	//fill model.elements with 8 node bricks on the nodes made by makeNodes with stride 1
+	//input:
+		//nelem = number of elements
+	model.elements.Free();
+	model.elements.Allocate(nelem);
+	for (int e = 0; e < nelem; e++)
+	{
+		int nodes[8];
+		for (int n = 0; n < 8; n++)
+			nodes[n] = 8 * e + n + 1;
+		SRelement* elem = model.elements.Add();
+		elem->Create(brick, e + 1, 8, nodes);
+		elem->id = e;
+		elem->matname = "steel";
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int reps = 15;
+	int nnodes = 200000;
+	if (argc > 1)
+		reps = atoi(argv[1]);
+	if (argc > 2)
+		nnodes = atoi(argv[2]);
+	if (reps < 1)
+		reps = 1;
+	if (nnodes < 64)
+		nnodes = 64;
+	nnodes -= nnodes % 8;
+	int nelem = nnodes / 8;
+	const int nfieldOps = 1000000;
+
+	bool positionsOk = checkPositions(100003);
+
+	SCREENPRINT("bdfBench: %d repetitions, %d nodes, %d elements, %d threads\n", reps, nnodes, nelem, SRparallel::GetNumThreads());
+	SCREENPRINT("%-28s %12s %10s %10s %10s %9s\n", "benchmark", "ops", "min ns", "median ns", "mean ns", "rsd");
+
+	//card reading, from a bdf file in memory:
+	string bdf;
+	makeBdf(nnodes, bdf);
+	SRfile& inp = model.inpFile;
+	inp.mapData = bdf.data();
+	inp.mapSize = (long long) bdf.size();
+	SRstring line, matname;
+	bool isComment, isMat;
+	runBench("GetBdfLine", nnodes + nelem, reps, NULL, [&]()
+	{
+		inp.MapSeek(0, 1);
+		long long n = 0;
+		while (inp.GetBdfLine(line, isComment, isMat, matname))
+			n += line.bdfFields.size();
+		benchSink = n;
+	});
+
+	//field parsing, on one assembled card of each kind:
+	SRstring grid, hexa;
+	inp.MapSeek(0, 1);
+	inp.GetBdfLine(grid, isComment, isMat, matname);
+	inp.MapSeek((long long) bdf.find("CHEXA"), nnodes + 1);
+	inp.GetBdfLine(hexa, isComment, isMat, matname);
+	inp.mapData = NULL;
+	inp.mapSize = 0;
+	int nhexaFields = (int) hexa.bdfFields.size() - 1;
+	runBench("BdfToken", nfieldOps, reps, NULL, [&]()
+	{
+		long long n = 0;
+		for (int i = 0; i < nfieldOps; i += nhexaFields)
+		{
+			hexa.bdfFieldNum = 1;
+			for (int f = 0; f < nhexaFields; f++)
+				n += hexa.BdfToken(false)[0];
+		}
+		benchSink = n;
+	});
+	runBench("BdfRead(int)", nfieldOps, reps, NULL, [&]()
+	{
+		long long n = 0;
+		int v;
+		for (int i = 0; i < nfieldOps; i += nhexaFields)
+		{
+			hexa.bdfFieldNum = 1;
+			for (int f = 0; f < nhexaFields; f++)
+			{
+				hexa.BdfRead(v);
+				n += v;
+			}
+		}
+		benchSink = n;
+	});
+	runBench("BdfRead(double)", nfieldOps, reps, NULL, [&]()
+	{
+		double s = 0.0;
+		double v;
+		for (int i = 0; i < nfieldOps; i += 3)
+		{
+			grid.bdfFieldNum = 3;
+			for (int f = 0; f < 3; f++)
+			{
+				grid.BdfRead(v);
+				s += v;
+			}
+		}
+		benchSink = (long long) s;
+	});
+	const char* reals[4] = { "1.25-3  ", "-3.5+1  ", "0.125   ", "4.E+2   " };
+	runBench("realStringCopy", nfieldOps, reps, NULL, [&]()
+	{
+		char dest[32];
+		long long n = 0;
+		for (int i = 0; i < nfieldOps; i++)
+		{
+			line.realStringCopy(dest, reals[i & 3], 8);
+			n += dest[1];
+		}
+		benchSink = n;
+	});
+	SRstring cmd("breakout box 0.0 0.0 0.0 100.0 50.0 25.0 rings 2");
+	runBench("Token", nfieldOps, reps, NULL, [&]()
+	{
+		long long n = 0;
+		for (int i = 0; i < nfieldOps; i += 10)
+		{
+			cmd.tokPos = 0;
+			for (int t = 0; t < 10; t++)
+				n += cmd.Token()[0];
+		}
+		benchSink = n;
+	});
+
+	//node lookup, in random order as for element connectivity:
+	vector <int> queries(nfieldOps);
+	unsigned seed = 12345;
+	for (int i = 0; i < nfieldOps; i++)
+		queries[i] = (int) (benchRandom(seed) % nnodes);
+	makeNodes(nnodes, 3);
+	runBench("NodeFind gapped", nfieldOps, reps, NULL, [&]()
+	{
+		long long n = 0;
+		for (int i = 0; i < nfieldOps; i++)
+			n += model.input.NodeFind(1 + 3 * queries[i]);
+		benchSink = n;
+	});
+	makeNodes(nnodes, 1);
+	runBench("NodeFind contiguous", nfieldOps, reps, NULL, [&]()
+	{
+		long long n = 0;
+		for (int i = 0; i < nfieldOps; i++)
+			n += model.input.NodeFind(1 + queries[i]);
+		benchSink = n;
+	});
+
+	//element faces, for PLOAD4 with a diagonal g1, g2 and with g2 off the face:
+	makeElements(nelem);
+	runBench("findElemFace", 2 * (long long) nelem, reps, NULL, [&]()
+	{
+		long long n = 0;
+		int gout[8];
+		for (SRindex e = 0; e < nelem; e++)
+		{
+			SRelement* elem = model.GetElement(e);
+			int g = 8 * e + 1;
+			n += model.input.findElemFace(false, elem, g, g + 2, gout);
+			n += model.input.findElemFace(true, elem, g + 4, g + 6, gout);
+		}
+		benchSink = n;
+	});
+
+	//.msh output, formatted as in a translation and written to the null device:
+	SRstring nullName(NULLDEVICE);
+	model.mshFile.SetFileName(nullName);
+	runBench("OutputNodes", nnodes, reps, [&]()
+	{
+		model.mshFile.Open(SRoutbinaryMode);
+		model.mshFile.StartAsyncWrite();
+	}, [&]()
+	{
+		benchSink = model.output.OutputNodes();
+		model.mshFile.Close();
+	});
+	runBench("OutputElements", nelem, reps, [&]()
+	{
+		makeElements(nelem);
+		model.mshFile.Open(SRoutbinaryMode);
+		model.mshFile.StartAsyncWrite();
+	}, [&]()
+	{
+		benchSink = model.output.OutputElements();
+		model.mshFile.Close();
+	});
+
+	return positionsOk ? 0 : 1;
+}
@@ -37,6 +37,8 @@ SRconstraint::SRconstraint()
 		constrainedDof[i] = 0;
 	coordId = -1;
 	breakoutElemUid = -1;
+	setId = -1;
+	card = NULL;
 }
 
 void SRconstraint::Clear()
@@ -66,6 +68,7 @@ void SRconstraint::Copy(SRconstraint& that)
 	entityId = that.entityId;
 	type = that.type;
 	coordId = that.coordId;
+	setId = that.setId;
 }
 
 void SRconstraint::PlusAssign(SRconstraint& that)
@@ -36,8 +36,10 @@ public:
 	{
 		for (int i = 0; i < 3; i++)
 			condof[i] = false;
+		setId = -1;
 	}
 	int nuid;
+	int setId; //load set id
 	bool condof[3];
 	double enfdVal;
 };
@@ -45,10 +47,11 @@ public:
 class SRunsup
 {
 public:
-	SRunsup(){ isShellOrBeam = false; isBsurf = false; };
+	SRunsup(){ isShellOrBeam = false; isBsurf = false; cardLine = 0; };
 	friend class SRinput;
 	bool isShellOrBeam;
 	bool isBsurf;
+	SRindex cardLine; //line number of the card, for error messages
 	SRintVector gids;
 };
 
@@ -95,6 +98,8 @@ public:
 	int coordId;
 	SRdoubleMatrix enforcedDisplacementData;
 	int breakoutElemUid;
+	int setId; //constraint set id, -1 for constraints on GRID cards, which are in every subcase
+	const char* card; //name of the card the constraint was read from, NULL if generated. for statistics
 };
 
 
@@ -22,6 +22,15 @@ also available at <https://www.gnu.org/licenses/>
 //////////////////////////////////////////////////////////////////////
 
 #include "SRmodel.h"
+#if defined(__x86_64__) || defined(_M_X64)
+#define SRCOORD_AVX2
+#include <immintrin.h>
+#ifdef linux
+#define SRCOORD_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define SRCOORD_AVX2_TARGET
+#endif
+#endif
 
 #ifdef _DEBUG
 #undef THIS_FILE
@@ -37,6 +46,10 @@ SRcoord::SRcoord()
 	e3.Zero();
 	e3.d[2] = 1.0;
 	otherCoordid = -1;//only used where definition of one cs references another
+	gcsaligned = true;
+	for (int i = 0; i < 3; i++)
+		defGrids[i] = -1;
+	cardLine = 0;
 }
 
 
@@ -53,25 +66,28 @@ void SRcoord::Copy(SRcoord& c2)
 	e3 = c2.e3;
 }
 
-void SRcoord::CalculateBasisVectors(SRvec3& p, SRvec3 &e1l, SRvec3 &e2l, SRvec3 &e3l)
+bool SRcoord::CalculateBasisVectors(SRvec3& p, SRvec3 &e1l, SRvec3 &e2l, SRvec3 &e3l)
 {
 	//calculate basis vectors for an lcs
 	//input:
 		//p = position
 	//output
 		//e1l, e2l, e3l = vectors
+	//return:
+		//false if p is at the origin of a cylindrical or spherical system, where the basis is not defined, else true
 	if (type == cartesian)
 	{
 		e1l.Copy(e1);
 		e2l.Copy(e2);
 		e3l.Copy(e3);
-		return;
+		return true;
 	}
 	SRvec3 erho;
 	p.Subtract(origin, erho);
-	double d =	erho.Normalize();
+	double d = erho.Length();
 	if (d < SMALL)
-		ERROREXIT;
+		return false;
+	erho.Normalize();
 	if (type == spherical)
 	{
 		//local coordinates rho,theta,phi
@@ -120,6 +136,7 @@ void SRcoord::CalculateBasisVectors(SRvec3& p, SRvec3 &e1l, SRvec3 &e2l, SRvec3
 			e2l.Normalize();
 		}
 	}
+	return true;
 }
 
 void SRcoord::Create(double x0, double y0, double z0)
@@ -131,6 +148,41 @@ void SRcoord::Create(double x0, double y0, double z0)
 	origin.Assign(x0, y0, z0);
 }
 
+bool SRcoord::CreateFromPoints(SRvec3& a, SRvec3& b, SRvec3& c)
+{
+	//Create a local coordinate system from 3 points in gcs, as defined on CORD1 and CORD2 cards
+	//input:
+		// a = origin
+		// b = point on the local e3 axis
+		// c = point in the local e1-e3 plane
+	//return:
+		//false if b is at a or c is on the line through a and b, so the axes are not defined, else true
+
+	origin.Copy(a);
+	SRvec3 p13;
+	c.Subtract(origin, p13);
+	b.Subtract(origin, e3);
+	double d = e3.Length();
+	if (d < SMALL)
+		return false;
+	e3.Normalize();
+	e3.Cross(p13, e2);
+	d = e2.Length();
+	if (d < SMALL)
+		return false;
+	e2.Normalize();
+	e2.Cross(e3, e1);
+	SRvec3 e1g, e3g;
+	e1g.Assign(1.0, 0.0, 0.0);
+	e3g.Assign(0.0, 0.0, 1.0);
+	gcsaligned = true;
+	if (e1g.Dot(e1) < (1.0 - SMALL))
+		gcsaligned = false;
+	if (e3g.Dot(e3) < (1.0 - SMALL))
+		gcsaligned = false;
+	return true;
+}
+
 void SRcoord::Create(double x0, double y0, double z0, SRvec3 p1, SRvec3 p3)
 {
 	//Create a local cartesian coordinate system aligned with gcs
@@ -230,16 +282,186 @@ void SRcoord::GetPos(double &x, double &y, double &z, SRvec3& pos)
 	pos.PlusAssign(origin);
 }
 
-void SRcoord::VecTransform(SRvec3 p, SRvec3& v)
+#ifdef SRCOORD_AVX2
+
+//cos of 4 doubles. the argument is reduced to [-pi/4, pi/4] with a 3 part pi/2 (Cody-Waite), then the
+//fdlibm sin and cos polynomials are used. agrees with the library cos to within a couple of units in the
+//last place for |x| < AVX2COSMAXARG; larger arguments are done with GetPos by the caller
+
+#define AVX2COSMAXARG 1.0e5
+
+SRCOORD_AVX2_TARGET static __m256d avx2Cos(__m256d x)
+{
+	const __m256d twoOverPi = _mm256_set1_pd(6.36619772367581382433e-01);
+	const __m256d pio2_1 = _mm256_set1_pd(1.57079632673412561417e+00);
+	const __m256d pio2_2 = _mm256_set1_pd(6.07710050630396597660e-11);
+	const __m256d pio2_3 = _mm256_set1_pd(2.02226624871116645580e-21);
+	__m256d n = _mm256_round_pd(_mm256_mul_pd(x, twoOverPi), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	__m256d r = _mm256_sub_pd(x, _mm256_mul_pd(n, pio2_1));
+	r = _mm256_sub_pd(r, _mm256_mul_pd(n, pio2_2));
+	r = _mm256_sub_pd(r, _mm256_mul_pd(n, pio2_3));
+	__m256d z = _mm256_mul_pd(r, r);
+
+	//sin(r) = r + r*z*(S1 + z*(S2 + ... z*S6)):
+	__m256d ps = _mm256_set1_pd(1.58969099521155010221e-10);
+	ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(-2.50507602534068634195e-08));
+	ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(2.75573137070700676789e-06));
+	ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(-1.98412698298579493134e-04));
+	ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(8.33333333332248946124e-03));
+	ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(-1.66666666666666324348e-01));
+	__m256d s = _mm256_add_pd(r, _mm256_mul_pd(_mm256_mul_pd(r, z), ps));
+
+	//cos(r) = 1 - z/2 + z*z*(C1 + z*(C2 + ... z*C6)):
+	__m256d pc = _mm256_set1_pd(-1.13596475577881948265e-11);
+	pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(2.08757232129817482790e-09));
+	pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(-2.75573143513906633035e-07));
+	pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(2.48015872894767294178e-05));
+	pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(-1.38888888888741095749e-03));
+	pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(4.16666666666666019037e-02));
+	__m256d hz = _mm256_mul_pd(_mm256_set1_pd(0.5), z);
+	__m256d w = _mm256_sub_pd(_mm256_set1_pd(1.0), hz);
+	__m256d c = _mm256_add_pd(w, _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), w), hz),
+		_mm256_mul_pd(_mm256_mul_pd(z, z), pc)));
+
+	//quadrant n mod 4: cos(x) = cos(r), -sin(r), -cos(r), sin(r):
+	__m128i q = _mm256_cvtpd_epi32(n);
+	__m256i q64 = _mm256_cvtepi32_epi64(q);
+	__m256i one = _mm256_set1_epi64x(1);
+	__m256i two = _mm256_set1_epi64x(2);
+	__m256d useSin = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(q64, one), one));
+	__m256i qp1 = _mm256_add_epi64(q64, one);
+	__m256d negate = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(qp1, two), two));
+	__m256d v = _mm256_blendv_pd(c, s, useSin);
+	__m256d signBit = _mm256_and_pd(negate, _mm256_set1_pd(-0.0));
+	return _mm256_xor_pd(v, signBit);
+}
+
+SRCOORD_AVX2_TARGET static SRindex avx2Positions(SRcoord* coord, SRindex n, double* x, double* y, double* z)
+{
+	//transform points in lcs to gcs 4 at a time, see SRcoord::GetPositions. the arithmetic is the same as GetPos
+	//except for the cosine
+	//return:
+		//number of points done; the remaining n % 4 are left for the caller.
+		//groups of 4 with an argument out of range for avx2Cos are done here with GetPos
+	SRcoordType type = coord->type;
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d maxArg = _mm256_set1_pd(AVX2COSMAXARG);
+	const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+	SRindex i;
+	for (i = 0; i + 4 <= n; i += 4)
+	{
+		__m256d px = _mm256_loadu_pd(x + i);
+		__m256d py = _mm256_loadu_pd(y + i);
+		__m256d pz = _mm256_loadu_pd(z + i);
+		if (type == cylindrical || type == spherical)
+		{
+			//arguments out of range (or not finite) are done by GetPos:
+			__m256d big = _mm256_cmp_pd(_mm256_and_pd(py, absMask), maxArg, _CMP_NLT_UQ);
+			if (type == spherical)
+				big = _mm256_or_pd(big, _mm256_cmp_pd(_mm256_and_pd(pz, absMask), maxArg, _CMP_NLT_UQ));
+			if (_mm256_movemask_pd(big) != 0)
+			{
+				for (int k = 0; k < 4; k++)
+				{
+					SRvec3 pos;
+					coord->GetPos(x[i + k], y[i + k], z[i + k], pos);
+					x[i + k] = pos.d[0];
+					y[i + k] = pos.d[1];
+					z[i + k] = pos.d[2];
+				}
+				continue;
+			}
+		}
+		if (type == cylindrical)
+		{
+			__m256d r = px;
+			__m256d ct = avx2Cos(py);
+			__m256d st = _mm256_sqrt_pd(_mm256_sub_pd(one, _mm256_mul_pd(ct, ct)));
+			px = _mm256_mul_pd(r, ct);
+			py = _mm256_mul_pd(r, st);
+		}
+		else if (type == spherical)
+		{
+			__m256d r = px;
+			__m256d cphi = avx2Cos(pz);
+			__m256d sphi = _mm256_sqrt_pd(_mm256_sub_pd(one, _mm256_mul_pd(cphi, cphi)));
+			__m256d ct = avx2Cos(py);
+			__m256d st = _mm256_sqrt_pd(_mm256_sub_pd(one, _mm256_mul_pd(ct, ct)));
+			px = _mm256_mul_pd(_mm256_mul_pd(r, ct), sphi);
+			py = _mm256_mul_pd(_mm256_mul_pd(r, st), sphi);
+			pz = _mm256_mul_pd(r, cphi);
+		}
+		if (!coord->gcsaligned)
+		{
+			__m256d xt = px;
+			__m256d yt = py;
+			__m256d zt = pz;
+			SRvec3& e1 = coord->e1;
+			SRvec3& e2 = coord->e2;
+			SRvec3& e3 = coord->e3;
+			px = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(xt, _mm256_set1_pd(e1.d[0])), _mm256_mul_pd(yt, _mm256_set1_pd(e2.d[0]))),
+				_mm256_mul_pd(zt, _mm256_set1_pd(e3.d[0])));
+			py = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(xt, _mm256_set1_pd(e1.d[1])), _mm256_mul_pd(yt, _mm256_set1_pd(e2.d[1]))),
+				_mm256_mul_pd(zt, _mm256_set1_pd(e3.d[1])));
+			pz = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(xt, _mm256_set1_pd(e1.d[2])), _mm256_mul_pd(yt, _mm256_set1_pd(e2.d[2]))),
+				_mm256_mul_pd(zt, _mm256_set1_pd(e3.d[2])));
+		}
+		px = _mm256_add_pd(px, _mm256_set1_pd(coord->origin.d[0]));
+		py = _mm256_add_pd(py, _mm256_set1_pd(coord->origin.d[1]));
+		pz = _mm256_add_pd(pz, _mm256_set1_pd(coord->origin.d[2]));
+		_mm256_storeu_pd(x + i, px);
+		_mm256_storeu_pd(y + i, py);
+		_mm256_storeu_pd(z + i, pz);
+	}
+	return i;
+}
+#endif
+
+void SRcoord::GetPositions(SRindex n, double* x, double* y, double* z)
+{
+	//convert n points in lcs to positions in gcs, in place. same as calling GetPos for each point
+	//input:
+		//n = number of points
+		//x, y, z = lcs coordinates of the points
+	//output:
+		//x, y, z = gcs positions
+	//note:
+		//uses AVX2 when the processor supports it (SRmachDep::cpuHasAvx2), else GetPos.
+		//the AVX2 cosine may differ from the library cos in the last couple of bits
+	SRindex i = 0;
+#ifdef SRCOORD_AVX2
+	if (SRmachDep::cpuHasAvx2())
+		i = avx2Positions(this, n, x, y, z);
+#endif
+	for (; i < n; i++)
+	{
+		SRvec3 pos;
+		GetPos(x[i], y[i], z[i], pos);
+		x[i] = pos.d[0];
+		y[i] = pos.d[1];
+		z[i] = pos.d[2];
+	}
+}
+
+bool SRcoord::VecTransform(SRvec3 p, SRvec3& v)
 {
 	//transform an lcs vector to gcs
+	//input:
+		//p = position the vector is at
+		//v = vector in lcs
+	//output:
+		//v = vector in gcs, unchanged if the basis is not defined at p
+	//return:
+		//false if the basis is not defined at p, see CalculateBasisVectors, else true
 	SRvec3 vlcs, e1l, e2l, e3l;
-	CalculateBasisVectors(p, e1l, e2l, e3l);
+	if (!CalculateBasisVectors(p, e1l, e2l, e3l))
+		return false;
 	vlcs.Copy(v);
 	v.Zero();
 	v.PlusAssign(e1l.d, vlcs.d[0]);
 	v.PlusAssign(e2l.d, vlcs.d[1]);
 	v.PlusAssign(e3l.d, vlcs.d[2]);
+	return true;
 }
 
 int SRcoord::checkParallelToGcs(int dof)
@@ -35,9 +35,11 @@ public:
 	void Create(double x0, double y0, double z0, SRvec3 p1, SRvec3 p3);
 	void Create(double x0, double y0, double z0, double alf, double bet, double gam);
 	void Create(double x0, double y0, double z0);
-	void CalculateBasisVectors(SRvec3& p, SRvec3 &e1l, SRvec3 &e2l, SRvec3 &e3l);
+	bool CreateFromPoints(SRvec3& a, SRvec3& b, SRvec3& c);
+	bool CalculateBasisVectors(SRvec3& p, SRvec3 &e1l, SRvec3 &e2l, SRvec3 &e3l);
 	void GetPos(double &x, double &y, double &z, SRvec3& pos);
-	void VecTransform(SRvec3 p, SRvec3 &v);
+	void GetPositions(SRindex n, double* x, double* y, double* z);
+	bool VecTransform(SRvec3 p, SRvec3 &v);
 	void Copy(SRcoord& c2);
 	void operator =(SRcoord& c2){ Copy(c2); };
 	SRcoordType GetType(){ return type; };
@@ -53,8 +55,12 @@ public:
 	SRvec3 origin;
 	SRvec3 e1, e2, e3;
 	SRstring coordname;
-	int otherCoordid;
+	int otherCoordid; //user id of the reference system (CORD2 RID), -1 for gcs
 	bool gcsaligned;
+	//definition until the system is resolved to gcs, see SRinput::resolveCoords:
+	SRvec3 defPoints[3]; //CORD2: points a, b, c, in the reference system
+	int defGrids[3]; //CORD1: user ids of the grids g1, g2, g3. -1 for CORD2
+	SRindex cardLine; //line number of the card that defined the system, for error messages
 };
 
 #endif // !defined(SRCOORD_INCLUDED)
@@ -197,21 +197,12 @@ bool SRelement::InsideBoundingBox(double xmin, double xmax, double ymin, double
 	return true;
 }
 
-int SRelement::GetNodeId(int i)
+SRindex SRelement::GetNodeId(int i)
 {
 	int uid = nodeUIds.Get(i);
 	return model.input.NodeFind(uid);
 }
 
-void SRelement::SetNodeElmentOwners()
-{
-	for (int i = 0; i < nodeUIds.GetNum(); i++)
-	{
-		int nuid = nodeUIds.Get(i);
-		SRnode* node = model.GetNodeFromUid(nuid);
-		node->firstElementOwner = id;
-	}
-}
 int SRelement::GetNumLocalFaces()
 {
 	if (type == brick)
@@ -39,22 +39,21 @@ public:
 	void GetFaceNodes(int lface, int& n1, int& n2, int& n3, int& n4);
 	void Create(SRelementType typet, int userid, int nnodes, int nodest[]);
 	int GetUserid(){ return uid; };
-	int GetId(){ return id; };
+	SRindex GetId(){ return id; };
 	SRelementType GetType(){ return type; };
 	int GetNumNodes(){ return nodeUIds.GetNum(); };
-	int GetNodeId(int i);
+	SRindex GetNodeId(int i);
 	int GetNumLocalFaces();
 	int GetMaterialId(){ return matid; };
 	void Cleanup();
 	bool nodeDistCheck(SRvec3& pos, double radius);
 	bool InsideBoundingBox(double xmin, double xmax, double ymin, double ymax, double zmin, double zmax);
-	void SetNodeElmentOwners();
 	int GetNumCorners();
 
-	SRelement(){ type = tet; saveForBreakout = false; };
+	SRelement(){ type = tet; saveForBreakout = false; bsurfOnly = false; };
 	~SRelement(){ Cleanup(); };
 	int uid;
-	int id;
+	SRindex id;
 	SRelementType type;
 	SRintVector nodeUIds;
 	SRstring matname;
@@ -62,6 +61,7 @@ public:
 	double size;
 	int numNodes;
 	bool saveForBreakout;
+	bool bsurfOnly; //cropped element kept only until BSURFS are processed
 };
 
 #endif //!defined(SRELEMENT_INCLUDED)
@@ -27,16 +27,106 @@ also available at <https://www.gnu.org/licenses/>
 #include "SRmachDep.h"
 #include "SRfile.h"
 #include "SRmodel.h"
+#include "SRparallel.h"
+#include <mutex>
+#include <chrono>
 
 
 extern SRmodel model;
 
+struct SRlogRecord
+{
+	//a message in the logging ring buffer, see SRfile::StartLogging
+	atomic <size_t> seq; //ring position this slot is ready to be written at (+1 when it holds a message)
+	SRfile* file;
+	int len;
+	char text[MAXLINELENGTH];
+};
+
+class SRlogger
+{
+	//state of the logging subsystem, see SRfile::StartLogging
+public:
+	bool async; //true if messages go through the ring to the flusher thread
+	SRlogRecord* ring;
+	atomic <size_t> enqueuePos; //next ring position claimed by a producer
+	size_t dequeuePos; //next ring position written by the flusher
+	thread flusher;
+	atomic <bool> stopping;
+	mutex lock; //serializes writes when not async
+};
+
+static SRlogger* logger = NULL;
+
+struct SRbdfCard
+{
+	//a card read ahead by the prefetch thread, with the outputs of GetBdfLine for it
+	SRstring line;
+	bool isComment;
+	bool isMat;
+	SRstring matname;
+	SRindex cardLine;
+	long long cardPos;
+	bool ret;
+};
+
+struct SRbdfCardBatch
+{
+	SRbdfCard cards[PREFETCHBATCHSIZE];
+	int num;
+};
+
+class SRbdfPrefetch
+{
+	//state of the prefetch pipeline, see SRfile::StartBdfPrefetch
+public:
+	SRbdfCardBatch batches[PREFETCHQUEUEDEPTH];
+	SRspscQueue <SRbdfCardBatch*> full; //batches read, in file order
+	SRspscQueue <SRbdfCardBatch*> empty; //batches returned by the parser for reuse
+	thread reader;
+	SRbdfCardBatch* cur; //batch being parsed
+	int next; //next card of cur
+	bool ended; //GetBdfLine has returned false
+};
+
+struct SRwriteChunk
+{
+	vector <char> buf;
+	size_t used;
+};
+
+class SRasyncWriter
+{
+	//state of the write-behind pipeline, see SRfile::StartAsyncWrite
+public:
+	vector <SRwriteChunk> chunks;
+	SRspscQueue <SRwriteChunk*> full; //chunks formatted, in file order. NULL ends the writer thread
+	SRspscQueue <SRwriteChunk*> empty; //chunks written, for reuse
+	thread writerThread;
+	SRwriteChunk* cur; //chunk being formatted
+	long long pos; //file position after the data formatted so far
+	long long numPushed; //chunks given to the writer thread
+	atomic <long long> numWritten; //chunks written by the writer thread
+	atomic <bool> failed;
+};
+
 SRfile::SRfile()
 {
+	prefetch = NULL;
+	writer = NULL;
 	fileptr = NULL;
 	opened = false;
 	filename = "";
 	bdfLineSaved = false;
+	bdfLineSave = NULL;
+	bdfLineSaveLen = 0;
+	bdfLineSaveNumber = 0;
+	bdfCardLine = 0;
+	bdfCardPos = 0;
+	mapData = NULL;
+	mapSize = 0;
+	mapPos = 0;
+	lineNumber = 0;
 }
 
 bool SRfile::Open(FileOpenMode mode,const char *name)
@@ -97,18 +187,77 @@ bool SRfile::Open(FileOpenMode mode,const char *name)
 
 bool SRfile::GetBdfLine(SRstring& line, bool& isComment, bool &isMat, SRstring& matname)
 {
-	//get a line from a file. if the line contains continuations, read until done with continuations, concatting to this line
+	//get a card from the mapped file. if the card has continuation lines, read until done with continuations.
+	//output:
+		//line = the card. line.str is its first line; the fields of all its lines are in line.bdfFields,
+		//       which point into mapData so no line is copied
+		//isComment = true if the line is a comment
+		//isMat, matname = Femap material name comment, see SRstring::isBdfComment
+		//bdfCardLine = line number of the first line of the card
+		//bdfCardPos = offset in mapData of the first line of the card
+	//return:
+		//false at ENDDATA or end of file, else true
+	//note:
+		//if prefetching, the card was read ahead by ReadAheadBdfCards, see StartBdfPrefetch
+
+	if (prefetch == NULL)
+		return ReadBdfCard(line, isComment, isMat, matname, bdfCardLine, bdfCardPos);
+
+	SRbdfPrefetch* pf = prefetch;
+	if (pf->ended)
+		return false;
+	if (pf->cur == NULL || pf->next == pf->cur->num)
+	{
+		if (pf->cur != NULL)
+			pf->empty.Push(pf->cur);
+		pf->cur = NULL;
+		if (!pf->full.Pop(pf->cur))
+			return false;
+		pf->next = 0;
+	}
+	SRbdfCard& card = pf->cur->cards[pf->next++];
+	line.Swap(card.line);
+	bdfCardLine = card.cardLine;
+	bdfCardPos = card.cardPos;
+	if (!card.ret)
+	{
+		pf->ended = true;
+		return false;
+	}
+	isComment = card.isComment;
+	isMat = card.isMat;
+	if (card.isMat)
+		matname.Swap(card.matname);
+	return true;
+}
+
+bool SRfile::ReadBdfCard(SRstring& line, bool& isComment, bool &isMat, SRstring& matname, SRindex& cardLine, long long& cardPos)
+{
+	//read a card from the mapped file, see GetBdfLine
+	//output:
+		//cardLine = line number of the first line of the card
+		//cardPos = offset in mapData of the first line of the card, mapSize at end of file
 
+	const char* s;
+	int len;
 	if (bdfLineSaved)
 	{
-		line.Copy(bdfLineSave);
+		s = bdfLineSave;
+		len = bdfLineSaveLen;
+		cardLine = bdfLineSaveNumber;
 		bdfLineSaved = false;
 	}
 	else
 	{
-		if (!GetLine(line))
+		if (!GetLineView(s, len))
+		{
+			cardPos = mapSize;
 			return false;
+		}
+		cardLine = lineNumber;
 	}
+	cardPos = s - mapData;
+	line.Assign(s, len);
 	if (line.CompareUseLength("ENDDATA"))
 		return false;
 	if (line.isBdfComment(isMat, matname))
@@ -118,64 +267,284 @@ bool SRfile::GetBdfLine(SRstring& line, bool& isComment, bool &isMat, SRstring&
 	}
 	else
 		isComment = false;
-	//check for csv:
-	line.setTokSep(' ');
-	if (line.LastChar(',') != NULL)
-		line.setTokSep(',');
-
-	//continuation check: next line starts with a $ for a comment, skip it, or +, *, ',', or blank:
-	SRstring line2;
-	bool firstContinue = true;
+
+	//check for csv or large field:
+	line.bdfStartCard();
+
+	//continuation check: next line starts with +, *, ',', or blank:
+	bool firstLine = true;
 	while (1)
 	{
-		if (!GetLine(line2))
-			return false;
-		char c0 = line2.GetChar(0);
-		if (c0 == '+' ||
-			c0 == '*' ||
-			c0 == ',' ||
-			c0 == ' ')
+		const char* s2;
+		int len2;
+		bool more = GetLineView(s2, len2);
+		bool continued = false;
+		if (more && len2 > 0)
 		{
-			if (!line.isCsv())
-			{
-				if (line2.getLength() > 72)
-					line2.truncate(72);
-				//continuation line, splice to 1st
-				if (firstContinue)
-					line.truncate(72); //strip trailing comment fields from 1st line
-				line.Cat(line2.str.substr(8).c_str()); // the 8 skips the first 8 fields of the continue, they are for opt. comment
-			}
-			else
+			char c0 = s2[0];
+			continued = (c0 == '+' || c0 == '*' || c0 == ',' || c0 == ' ');
+		}
+		line.bdfAddLine(s, len, firstLine, continued);
+		if (!continued)
+		{
+			if (more)
 			{
-				//skip the "," in line2:
-				line.Cat(line2.str.substr(1).c_str());//!!ttd make Right fun
+				//next keyword encountered:
+				bdfLineSave = s2;
+				bdfLineSaveLen = len2;
+				bdfLineSaveNumber = lineNumber;
+				bdfLineSaved = true;
 			}
-			bdfLineSaved = false;
-			firstContinue = false;
+			break;
 		}
-		else
+		s = s2;
+		len = len2;
+		firstLine = false;
+	}
+	return true;
+}
+
+void SRfile::StartBdfPrefetch()
+{
+	//start reading cards ahead on another thread while the caller parses them. GetBdfLine returns the cards
+	//in the same order. batches of cards go through a bounded queue, so at most PREFETCHQUEUEDEPTH batches
+	//are read ahead. the file must not be read any other way until StopBdfPrefetch
+	//note:
+		//does nothing if there is only one hardware thread
+
+	if (prefetch != NULL || mapData == NULL || SRparallel::GetNumThreads() < 2)
+		return;
+	prefetch = new SRbdfPrefetch;
+	SRbdfPrefetch* pf = prefetch;
+	pf->full.Allocate(PREFETCHQUEUEDEPTH);
+	pf->empty.Allocate(PREFETCHQUEUEDEPTH);
+	for (int b = 0; b < PREFETCHQUEUEDEPTH; b++)
+	{
+		pf->batches[b].num = 0;
+		pf->empty.Push(&pf->batches[b]);
+	}
+	pf->cur = NULL;
+	pf->next = 0;
+	pf->ended = false;
+	pf->reader = thread(&SRfile::ReadAheadBdfCards, this);
+}
+
+void SRfile::ReadAheadBdfCards()
+{
+	//prefetch thread: fill empty batches with cards until ENDDATA or end of file, see StartBdfPrefetch
+	SRbdfPrefetch* pf = prefetch;
+	while (1)
+	{
+		SRbdfCardBatch* batch;
+		if (!pf->empty.Pop(batch))
+			return;
+		batch->num = 0;
+		bool more = true;
+		while (more && batch->num < PREFETCHBATCHSIZE)
 		{
-			//next keyword encountered:
-			bdfLineSave.Copy(line2);
-			bdfLineSaved = true;
-			break;
+			SRbdfCard& card = batch->cards[batch->num++];
+			card.ret = ReadBdfCard(card.line, card.isComment, card.isMat, card.matname, card.cardLine, card.cardPos);
+			more = card.ret;
 		}
+		if (!pf->full.Push(batch) || !more)
+			return;
+	}
+}
+
+void SRfile::StopBdfPrefetch()
+{
+	//stop the prefetch thread. cards it read ahead are dropped
+	if (prefetch == NULL)
+		return;
+	prefetch->full.Abort();
+	prefetch->empty.Abort();
+	prefetch->reader.join();
+	DELETEMEMORY prefetch;
+	prefetch = NULL;
+}
+
+void SRfile::StartAsyncWrite()
+{
+	//write this file on another thread from now until it is closed. Print, PrintLine and WriteBytes format
+	//into chunks that go to the writer thread through a bounded queue, so at most ASYNCQUEUEDEPTH chunks
+	//are waiting to be written
+	//note:
+		//does nothing if the file is not open or there is only one hardware thread
+
+	if (writer != NULL || !opened || SRparallel::GetNumThreads() < 2)
+		return;
+	writer = new SRasyncWriter;
+	SRasyncWriter* w = writer;
+	w->chunks.resize(ASYNCQUEUEDEPTH + 1);
+	//one more slot than chunks so the NULL that ends the writer thread always fits:
+	w->full.Allocate(ASYNCQUEUEDEPTH + 2);
+	w->empty.Allocate(ASYNCQUEUEDEPTH + 1);
+	for (int c = 0; c <= ASYNCQUEUEDEPTH; c++)
+	{
+		w->chunks[c].buf.resize(ASYNCCHUNKSIZE);
+		w->chunks[c].used = 0;
+		if (c > 0)
+			w->empty.Push(&w->chunks[c]);
+	}
+	w->cur = &w->chunks[0];
+	w->pos = SRmachDep::fileTell(fileptr);
+	w->numPushed = 0;
+	w->numWritten = 0;
+	w->failed = false;
+	w->writerThread = thread(&SRfile::WriteBehind, this);
+}
+
+void SRfile::WriteBehind()
+{
+	//writer thread: write chunks in order until a NULL chunk is received, see StartAsyncWrite
+	SRasyncWriter* w = writer;
+	while (1)
+	{
+		SRwriteChunk* chunk;
+		if (!w->full.Pop(chunk) || chunk == NULL)
+			return;
+		if (fwrite(&chunk->buf[0], 1, chunk->used, fileptr) != chunk->used)
+			w->failed = true;
+		chunk->used = 0;
+		w->numWritten.fetch_add(1, memory_order_release);
+		w->empty.Push(chunk);
+	}
+}
+
+void SRfile::AsyncPushChunk()
+{
+	//give the chunk being formatted to the writer thread and get an empty one, waiting if necessary
+	SRasyncWriter* w = writer;
+	w->full.Push(w->cur);
+	w->numPushed++;
+	w->empty.Pop(w->cur);
+}
+
+void SRfile::AsyncFlush()
+{
+	//wait until everything formatted so far has been written
+	SRasyncWriter* w = writer;
+	if (w->cur->used > 0)
+		AsyncPushChunk();
+	while (w->numWritten.load(memory_order_acquire) < w->numPushed)
+		this_thread::yield();
+}
+
+bool SRfile::AsyncPrint(const char* fmt, va_list arglist)
+{
+	//format into the chunk being filled, see StartAsyncWrite
+	SRasyncWriter* w = writer;
+	SRwriteChunk* c = w->cur;
+	size_t room = c->buf.size() - c->used;
+	va_list args;
+	va_copy(args, arglist);
+	int n = vsnprintf(&c->buf[c->used], room, fmt, args);
+	va_end(args);
+	if (n < 0)
+		return false;
+	if ((size_t) n >= room)
+	{
+		AsyncPushChunk();
+		c = w->cur;
+		if ((size_t) n >= c->buf.size())
+			c->buf.resize(n + 1);
+		vsnprintf(&c->buf[0], c->buf.size(), fmt, arglist);
 	}
+	c->used += n;
+	w->pos += n;
+	return true;
+}
 
-	//reset to default (small field):
-	line.bdfWidth = 8;
-	//check for large field:
-	if (!line.isCsv())
+bool SRfile::AsyncWrite(const char* buf, long long n)
+{
+	//copy bytes into the chunks being filled, see StartAsyncWrite
+	SRasyncWriter* w = writer;
+	w->pos += n;
+	while (n > 0)
 	{
-		line.bdfCheckLargeField();
-		line.bdfPointer = 0;
+		SRwriteChunk* c = w->cur;
+		size_t nt = c->buf.size() - c->used;
+		if ((long long) nt > n)
+			nt = (size_t) n;
+		memcpy(&c->buf[c->used], buf, nt);
+		c->used += nt;
+		buf += nt;
+		n -= nt;
+		if (c->used == c->buf.size())
+			AsyncPushChunk();
 	}
 	return true;
 }
 
+bool SRfile::StopAsyncWrite()
+{
+	//write what is left, end the writer thread and go back to writing directly
+	//return:
+		//false if any write failed, else true
+	if (writer == NULL)
+		return true;
+	SRasyncWriter* w = writer;
+	if (w->cur->used > 0)
+		AsyncPushChunk();
+	w->full.Push(NULL);
+	w->writerThread.join();
+	bool ok = !w->failed;
+	DELETEMEMORY writer;
+	writer = NULL;
+	return ok;
+}
+
 void SRfile::ToTop()
 {
-	rewind(fileptr); bdfLineSaved = false;
+	if (fileptr != NULL)
+		rewind(fileptr);
+	mapPos = 0;
+	lineNumber = 0;
+	bdfLineSaved = false;
+}
+
+void SRfile::MapSeek(long long pos, SRindex line)
+{
+	//continue reading the mapped file at a line previously returned by GetLineView or GetBdfLine
+	//input:
+		//pos = offset of the line in mapData
+		//line = line number of the line
+	mapPos = pos;
+	lineNumber = line - 1;
+	bdfLineSaved = false;
+}
+
+unsigned long long SRfile::MapHash()
+{
+	//hash of the contents of the mapped file, used to tell if a file has changed since it was last read.
+	//the words are mixed in 4 independent lanes so the multiplies overlap
+	//return:
+		//the hash, 0 if the file is not mapped
+	if (mapData == NULL)
+		return 0;
+	const unsigned long long prime = 1099511628211ULL;
+	unsigned long long h[4];
+	for (int lane = 0; lane < 4; lane++)
+		h[lane] = 14695981039346656037ULL + (unsigned long long) lane;
+	long long nwords = mapSize / 8;
+	long long nblocks = nwords / 4;
+	const char* p = mapData;
+	for (long long b = 0; b < nblocks; b++)
+	{
+		for (int lane = 0; lane < 4; lane++)
+		{
+			unsigned long long w;
+			memcpy(&w, p, 8);
+			h[lane] = (h[lane] ^ w) * prime;
+			p += 8;
+		}
+	}
+	unsigned long long hash = (unsigned long long) mapSize;
+	for (int lane = 0; lane < 4; lane++)
+		hash = (hash ^ h[lane]) * prime;
+	for (; p < mapData + mapSize; p++)
+		hash = (hash ^ (unsigned char) *p) * prime;
+	return hash;
 }
 
 bool SRfile::Open(SRstring& fn, FileOpenMode mode)
@@ -188,6 +557,98 @@ void SRfile::SetFileName(SRstring& name)
 	filename = name;
 }
 
+bool SRfile::Map()
+{
+	//map the contents of this file into memory, read-only. contents are in mapData, mapSize
+	//return:
+		//true if successful, false if file doesn't exist, is empty, or can't be mapped
+	if (mapData != NULL)
+		return true;
+	if (filename.getLength() == 0)
+		return false;
+	mapData = SRmachDep::mapFile(filename.getStr(), mapSize);
+	mapPos = 0;
+	lineNumber = 0;
+	return (mapData != NULL);
+}
+
+void SRfile::Unmap()
+{
+	//release the memory map of this file, if any
+	StopBdfPrefetch();
+	if (mapData == NULL)
+		return;
+	SRmachDep::unmapFile(mapData, mapSize);
+	mapData = NULL;
+	mapSize = 0;
+	mapPos = 0;
+	bdfLineSaved = false;
+}
+
+bool SRfile::WriteBytes(const char* buf, long long n)
+{
+	//write n bytes from buf to this file unchanged
+	//return:
+		//true if successful else false
+	if (writer != NULL)
+		return AsyncWrite(buf, n);
+	while (n > 0)
+	{
+		size_t nt = fwrite(buf, 1, (size_t) n, fileptr);
+		if (nt == 0)
+			return false;
+		buf += nt;
+		n -= nt;
+	}
+	return true;
+}
+
+long long SRfile::Tell()
+{
+	//return:
+		//current write position of this file
+	if (writer != NULL)
+		return writer->pos;
+	return SRmachDep::fileTell(fileptr);
+}
+
+bool SRfile::Patch(long long pos, const char* buf, int n)
+{
+	//overwrite n bytes of this file at position pos with buf. the write position does not change
+	//return:
+		//true if successful else false
+	if (writer != NULL)
+		AsyncFlush();
+	return SRmachDep::filePatch(fileptr, pos, buf, n);
+}
+
+bool SRfile::GetLineView(const char*& line, int& len)
+{
+	//get the next line of the mapped file without copying it
+	//output:
+		//line = start of the line in mapData, not null-terminated
+		//len = length of the line, not including "\n" or "\r\n"
+	//return:
+		//false at end of file or if the file is not mapped
+	if (mapData == NULL || mapPos >= mapSize)
+		return false;
+	const char* s = mapData + mapPos;
+	const char* e = (const char*) memchr(s, '\n', (size_t) (mapSize - mapPos));
+	if (e == NULL)
+	{
+		e = mapData + mapSize;
+		mapPos = mapSize;
+	}
+	else
+		mapPos = (e - mapData) + 1;
+	len = (int) (e - s);
+	if (len > 0 && s[len - 1] == '\r')
+		len--;
+	line = s;
+	lineNumber++;
+	return true;
+}
+
 bool SRfile::GetLine(SRstring &line,bool noSlashN)
 {
     //get a line from a file
@@ -197,6 +658,17 @@ bool SRfile::GetLine(SRstring &line,bool noSlashN)
         //line = the fetched line stored as SRstring
     //return
         //true if successful else false (e.g. EOF)
+	if (mapData != NULL)
+	{
+		const char* s;
+		int len;
+		if (!GetLineView(s, len))
+			return false;
+		line.Assign(s, len);
+		if (!noSlashN)
+			line.Cat("\n");
+		return true;
+	}
 	line.Clear();
 	char *tmp,c;
 	int len;
@@ -230,10 +702,12 @@ bool SRfile::Close()
     //return:
 		//false if file was not opened or close is unsuccessful, else true
 
+	Unmap();
 	if(!opened)
 		return false;
+	bool written = StopAsyncWrite();
 	opened = false;
-	if(fclose(fileptr) != 0)
+	if(fclose(fileptr) != 0 || !written)
 		return false;
 	fileptr = NULL;
 	return true;
@@ -249,7 +723,11 @@ bool SRfile::Print(const char *fmt,...)
 
 	va_list arglist;
 	va_start(arglist, fmt);
-	int ret = vfprintf(fileptr, fmt, arglist);
+	int ret;
+	if (writer != NULL)
+		ret = AsyncPrint(fmt, arglist) ? 0 : -1;
+	else
+		ret = vfprintf(fileptr, fmt, arglist);
 	va_end(arglist);
 	if(ret < 0)
 		return false;
@@ -265,9 +743,10 @@ bool SRfile::VPrint(const char *fmt, va_list arglist)
 	//va_list = variable argument list
 
 	int ret = 0;
-	vprintf(fmt, arglist);
-	ret = vfprintf(fileptr, fmt, arglist);
-	va_end(arglist);
+	if (writer != NULL)
+		ret = AsyncPrint(fmt, arglist) ? 0 : -1;
+	else
+		ret = vfprintf(fileptr, fmt, arglist);
 	if (ret < 0)
 		return false;
 	else
@@ -301,13 +780,12 @@ bool SRfile::VPrintLine(const char *fmt, va_list arglist)
 	{
 		STRCPY(linebuf, MAXLINELENGTH, fmt);
 		STRCAT(linebuf, MAXLINELENGTH, "\n");
-		ret = vfprintf(fileptr, linebuf, arglist);
+		fmt = linebuf;
 	}
+	if (writer != NULL)
+		ret = AsyncPrint(fmt, arglist) ? 0 : -1;
 	else
-	{
 		ret = vfprintf(fileptr, fmt, arglist);
-	}
-	va_end(arglist);
 	if(ret < 0)
 		return false;
 	else
@@ -317,6 +795,8 @@ bool SRfile::VPrintLine(const char *fmt, va_list arglist)
 bool SRfile::PrintReturn()
 {
     //print "\n" to a file
+	if (writer != NULL)
+		return AsyncWrite("\n", 1);
 	int ret = fprintf(fileptr,"\n");
 	if(ret < 0)
 		return false;
@@ -368,18 +848,7 @@ void SRfile::Delete()
 bool SRfile::PrintOutFile()
 {
 	//print blank line to out file
-
-	SRfile* f = &model.outputFile;
-	bool opened = f->opened;
-	if (!opened)
-	{
-		if (!f->Open(SRappendMode))
-			return false;
-	}
-	f->PrintReturn();
-	if (!opened)
-		f->Close();
-	return true;
+	return PrintOutFile("");
 }
 
 bool SRfile::PrintOutFile(const char *fmt, ...)
@@ -391,21 +860,214 @@ bool SRfile::PrintOutFile(const char *fmt, ...)
 	//return:
 		//true if successful else false
 
-	SRfile* f = &model.outputFile;
-	bool opened = f->opened;
-	if (!opened)
-	{
-		if (!f->Open(SRappendMode))
-			return false;
-	}
 	va_list arglist;
 	va_start(arglist, fmt);
-	bool ret = f->VPrintLine(fmt, arglist);
-	if (!opened)
-		f->Close();
+	bool ret = LogLine(&model.outputFile, true, fmt, arglist);
+	va_end(arglist);
+	return ret;
+}
+
+bool SRfile::PrintLogFile(const char *fmt, ...)
+{
+	//print to the log file using format fmt; append \n
+	//input:
+		//fmt = format string
+		//... variable data to print
+	//return:
+		//true if successful else false
+	//note:
+		//the out file is deleted after a successful translation, the log file is kept.
+		//the message has level logInfo, see PrintLogLevel
+
+	if (model.logLevel > logInfo)
+		return true;
+	va_list arglist;
+	va_start(arglist, fmt);
+	bool ret = LogLine(&model.logFile, true, fmt, arglist);
+	va_end(arglist);
+	return ret;
+}
+
+bool SRfile::PrintLogLevel(SRlogLevel level, const char *fmt, ...)
+{
+	//print to the log file using format fmt if level is at least model.logLevel; append \n
+	//input:
+		//level = severity of the message
+		//fmt = format string
+		//... variable data to print
+	//return:
+		//true if successful else false
+
+	if (level < model.logLevel)
+		return true;
+	va_list arglist;
+	va_start(arglist, fmt);
+	bool ret = LogLine(&model.logFile, true, fmt, arglist);
+	va_end(arglist);
 	return ret;
 }
 
+bool SRfile::LogLine(SRfile* f, bool newline, const char* fmt, va_list arglist)
+{
+	//append a message to the out file or the log file.
+	//if logging is started, the message is formatted into the ring buffer and written by the flusher
+	//thread, or written directly to the file, which stays open. otherwise the file is opened in append
+	//mode, written and closed again
+	//input:
+		//f = model.outputFile or model.logFile
+		//newline = true to append \n
+		//fmt, arglist = message, printf style
+	//return:
+		//true if successful else false
+	//note:
+		//can be called from any thread once logging is started
+
+	SRlogger* lg = logger;
+	if (lg == NULL)
+	{
+		bool opened = f->opened;
+		if (!opened)
+		{
+			if (!f->Open(SRappendMode))
+				return false;
+		}
+		bool ret = newline ? f->VPrintLine(fmt, arglist) : f->VPrint(fmt, arglist);
+		if (!opened)
+			f->Close();
+		return ret;
+	}
+
+	if (!lg->async)
+	{
+		lock_guard <mutex> guard(lg->lock);
+		if (!f->opened && !f->Open(SRappendMode))
+			return false;
+		return newline ? f->VPrintLine(fmt, arglist) : f->VPrint(fmt, arglist);
+	}
+
+	//claim a slot. if the ring is full, wait for the flusher:
+	SRlogRecord* rec;
+	size_t pos = lg->enqueuePos.load(memory_order_relaxed);
+	while (1)
+	{
+		rec = &lg->ring[pos & (LOGRINGSIZE - 1)];
+		size_t seq = rec->seq.load(memory_order_acquire);
+		if (seq == pos)
+		{
+			if (lg->enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+				break;
+		}
+		else if (seq < pos)
+		{
+			this_thread::yield();
+			pos = lg->enqueuePos.load(memory_order_relaxed);
+		}
+		else
+			pos = lg->enqueuePos.load(memory_order_relaxed);
+	}
+	int room = MAXLINELENGTH - 1;
+	int len = vsnprintf(rec->text, room, fmt, arglist);
+	if (len < 0)
+		len = 0;
+	else if (len >= room)
+		len = room - 1;
+	if (newline && (len == 0 || rec->text[len - 1] != '\n'))
+		rec->text[len++] = '\n';
+	rec->len = len;
+	rec->file = f;
+	rec->seq.store(pos + 1, memory_order_release);
+	return true;
+}
+
+static void logFlusher()
+{
+	//flusher thread: write the messages in the ring in order until logging is stopped and the ring is empty.
+	//the files are flushed whenever the ring runs empty
+	SRlogger* lg = logger;
+	bool dirty = false;
+	while (1)
+	{
+		SRlogRecord* rec = &lg->ring[lg->dequeuePos & (LOGRINGSIZE - 1)];
+		if (rec->seq.load(memory_order_acquire) == lg->dequeuePos + 1)
+		{
+			SRfile* f = rec->file;
+			if (f->opened || f->Open(SRappendMode))
+			{
+				f->WriteBytes(rec->text, rec->len);
+				dirty = true;
+			}
+			rec->seq.store(lg->dequeuePos + LOGRINGSIZE, memory_order_release);
+			lg->dequeuePos++;
+			continue;
+		}
+		if (dirty)
+		{
+			if (model.logFile.opened)
+				fflush(model.logFile.fileptr);
+			if (model.outputFile.opened)
+				fflush(model.outputFile.fileptr);
+			dirty = false;
+		}
+		if (lg->stopping.load(memory_order_acquire) && lg->enqueuePos.load(memory_order_acquire) == lg->dequeuePos)
+			return;
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+}
+
+void SRfile::StartLogging()
+{
+	//start the logging subsystem. from now until StopLogging, OUTPRINT, LOGPRINT and LOGPRINTLEVEL keep
+	//the out file and log file open instead of opening and closing them for every message.
+	//with more than one hardware thread, messages are formatted into a lock-free ring buffer of
+	//LOGRINGSIZE messages and written by a flusher thread, so logging costs a format and a copy.
+	//producers wait if the ring is full; no message is dropped
+	//note:
+		//the files must not be written any other way until StopLogging.
+		//StopLogging is called at exit, so messages before an ERROREXIT are not lost
+
+	if (logger != NULL)
+		return;
+	SRlogger* lg = new SRlogger;
+	lg->async = (SRparallel::GetNumThreads() > 1);
+	lg->ring = NULL;
+	lg->dequeuePos = 0;
+	lg->enqueuePos = 0;
+	lg->stopping = false;
+	if (lg->async)
+	{
+		lg->ring = new SRlogRecord[LOGRINGSIZE];
+		for (size_t i = 0; i < LOGRINGSIZE; i++)
+			lg->ring[i].seq = i;
+	}
+	logger = lg;
+	if (lg->async)
+		lg->flusher = thread(logFlusher);
+	static bool atExitSet = false;
+	if (!atExitSet)
+	{
+		atexit(SRfile::StopLogging);
+		atExitSet = true;
+	}
+}
+
+void SRfile::StopLogging()
+{
+	//write the messages still in the ring, stop the flusher thread and close the out and log files
+	SRlogger* lg = logger;
+	if (lg == NULL)
+		return;
+	if (lg->async)
+	{
+		lg->stopping.store(true, memory_order_release);
+		lg->flusher.join();
+		delete [] lg->ring;
+	}
+	logger = NULL;
+	DELETEMEMORY lg;
+	model.logFile.Close();
+	model.outputFile.Close();
+}
+
 bool SRfile::PrintOutFileNoReturn(const char *fmt, ...)
 {
 	//print to file using format fmt;
@@ -415,28 +1077,23 @@ bool SRfile::PrintOutFileNoReturn(const char *fmt, ...)
 	//return:
 	//true if successful else false
 
-	SRfile* f = &model.outputFile;
-	bool opened = f->opened;
-	if (!opened)
-	{
-		if (!f->Open(SRappendMode))
-			return false;
-	}
 	va_list arglist;
 	va_start(arglist, fmt);
-	bool ret = f->VPrint(fmt, arglist);
-	if (!opened)
-		f->Close();
+	bool ret = LogLine(&model.outputFile, false, fmt, arglist);
+	va_end(arglist);
 	return ret;
 }
 
 void SRfile::OpenOutFile()
 {
-	model.outputFile.Open(SRappendMode);
+	//keep the out file open between messages. not needed once logging is started
+	if (logger == NULL)
+		model.outputFile.Open(SRappendMode);
 }
 void SRfile::CloseOutFile()
 {
-	model.outputFile.Close();
+	if (logger == NULL)
+		model.outputFile.Close();
 }
 
 
@@ -450,9 +1107,9 @@ bool SRfile::Screenprint(const char *fmt, ...)
 		//true if successful else false
 	va_list arglist;
 	va_start(arglist, fmt);
-	int ret = 0;
-	ret = vprintf(fmt, arglist);
-	return ret;
+	int ret = vprintf(fmt, arglist);
+	va_end(arglist);
+	return (ret >= 0);
 }
 
 bool SRfile::CreateDir(const char *name)
@@ -33,10 +33,27 @@ also available at <https://www.gnu.org/licenses/>
 #define OUTCLOSE SRfile::CloseOutFile
 #define OUTPRINT SRfile::PrintOutFile
 #define OUTPRINTNORET SRfile::PrintOutFileNoReturn
+#define LOGPRINT SRfile::PrintLogFile
+#define LOGPRINTLEVEL SRfile::PrintLogLevel
 #define SCREENPRINT SRfile::Screenprint
 
 enum FileOpenMode{ SRinputMode, SRoutputMode, SRappendMode, SRoutbinaryMode, SRinbinaryMode, SRinoutbinaryMode };
 
+//severity of log file messages. messages below model.logLevel are not written:
+enum SRlogLevel{ logDebug, logInfo, logWarning, logError };
+
+//number of messages the logging ring buffer holds, a power of 2. see SRfile::StartLogging
+#define LOGRINGSIZE 512
+
+//read-ahead and write-behind pipelines, see SRfile::StartBdfPrefetch and StartAsyncWrite:
+#define PREFETCHBATCHSIZE 256
+#define PREFETCHQUEUEDEPTH 8
+#define ASYNCCHUNKSIZE (256 * 1024)
+#define ASYNCQUEUEDEPTH 8
+
+class SRbdfPrefetch;
+class SRasyncWriter;
+
 class SRfile
 {
 	friend class SRoutput;
@@ -51,6 +68,11 @@ public:
 	static bool PrintOutFileNoReturn(const char *fmt, ...);
 	static bool PrintOutFile(const char *fmt, ...);
 	static bool PrintOutFile();
+	static bool PrintLogFile(const char *fmt, ...);
+	static bool PrintLogLevel(SRlogLevel level, const char *fmt, ...);
+	static bool LogLine(SRfile* f, bool newline, const char* fmt, va_list arglist);
+	static void StartLogging();
+	static void StopLogging();
 	static bool Screenprint(const char *fmt, ...);
 	static void OpenOutFile();
 	static void CloseOutFile();
@@ -61,19 +83,51 @@ public:
 	bool Close();
 	void ToTop();
 	bool GetBdfLine(SRstring& line, bool& isComment, bool &isMat, SRstring& matname);
+	bool ReadBdfCard(SRstring& line, bool& isComment, bool &isMat, SRstring& matname, SRindex& cardLine, long long& cardPos);
+	void MapSeek(long long pos, SRindex line);
+	unsigned long long MapHash();
+	void StartBdfPrefetch();
+	void StopBdfPrefetch();
+	void ReadAheadBdfCards();
+	void StartAsyncWrite();
+	bool StopAsyncWrite();
+	void WriteBehind();
+	bool AsyncPrint(const char* fmt, va_list arglist);
+	bool AsyncWrite(const char* buf, long long n);
+	void AsyncPushChunk();
+	void AsyncFlush();
 	bool GetLine(SRstring& line, bool noSlashN = true);
+	bool GetLineView(const char*& line, int& len);
 	bool Open(FileOpenMode mode, const char* name = NULL);
 	bool Open(SRstring& fn, FileOpenMode mode);
 	bool Print(const char* s, ...);
 	bool PrintLine(const char* s, ...);
 	void SetFileName(SRstring& name);
+	bool Map();
+	void Unmap();
+	bool WriteBytes(const char* buf, long long n);
+	long long Tell();
+	bool Patch(long long pos, const char* buf, int n);
 
 	SRstring tmpstr;
 	FILE* fileptr;
 	bool opened;
 	SRstring filename;
 	char linebuf[MAXLINELENGTH];
+	//read-only memory map of the file, see Map():
+	const char* mapData;
+	long long mapSize;
+	//read position in mapData and number of lines read, see GetLineView:
+	long long mapPos;
+	SRindex lineNumber;
+	//lookahead line saved by GetBdfLine, a view into mapData:
 	bool bdfLineSaved;
-	SRstring bdfLineSave;
+	const char* bdfLineSave;
+	int bdfLineSaveLen;
+	SRindex bdfLineSaveNumber;
+	SRindex bdfCardLine; //line number of the first line of the last card returned by GetBdfLine
+	long long bdfCardPos; //offset in mapData of the first line of the last card returned by GetBdfLine
+	SRbdfPrefetch* prefetch; //cards being read ahead on another thread, NULL if not prefetching
+	SRasyncWriter* writer; //output being written on another thread, NULL if writing directly
 };
 #endif //if !(defined SRFILE_INCLUDED)
@@ -36,6 +36,7 @@ void SRforce::Copy(SRforce& that, bool copyForceVals)
 	pressure = that.isPressure();
 	coordId = that.coordId;
 	entityId = that.entityId;
+	setId = that.setId;
 	if (copyForceVals)
 		forceVals.Copy(that.forceVals);
 }
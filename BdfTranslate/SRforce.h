@@ -48,7 +48,7 @@ public:
 
 	SRforce()
 	{
-		type = nodalForce; pressure = false; coordId = -1; numDuplicates = 1; constant = false;
+		type = nodalForce; pressure = false; coordId = -1; numDuplicates = 1; constant = false; setId = -1;
 		for (int n = 0; n < 4; n++)
 			nv[n] = -1;
 	};
@@ -59,6 +59,7 @@ private:
 	int coordId;
 	int entityId; //node id, or element id for pressure on faces
 	int nv[4]; //nodes at corners of face for pressure on faces
+	int setId; //load set id
 	int numDuplicates;
 	SRdoubleMatrix forceVals;
 	bool pressure;
@@ -85,7 +86,7 @@ class SRvolumeForce
 	friend class SRinput;
 
 public:
-	SRvolumeForce(){ g1 = g2 = g3 = 0.0; omega = 0.0; alpha = 0.0; }
+	SRvolumeForce(){ g1 = g2 = g3 = 0.0; omega = 0.0; alpha = 0.0; originGid = -1; coordId = -1; setId = -1; }
 	void GetForceValue(SRelement* elem, SRvec3& p, double val[]);
 	SRvolumeForceType GetType(){ return type; };
 
@@ -98,6 +99,40 @@ private:
 	double alpha;
 	SRvec3 axis;
 	SRvec3 origin;
+	int originGid; //user id of origin node, until origin is filled in finishVolumeForces
+	int coordId; //coordinate system of g1, g2, g3 or axis, until transformed to gcs in finishVolumeForces
+	int setId; //load set id
+};
+
+struct SRnodeTemp
+{
+	//temperature of a node in a TEMP set, until applied to the node in SRinput::finishTemps.
+	//kept when the case control has more than one subcase
+	int setId;
+	int nodeUid;
+	double T;
+};
+
+class SRsubcase
+{
+	//loads and constraints selected by a case control subcase, see SRinput::readCaseControl
+public:
+	SRsubcase(){ id = 0; loadSet = -1; spcSet = -1; tempSet = -1; };
+	int id;
+	int loadSet; //LOAD = set id, -1 for none
+	int spcSet; //SPC = set id, -1 for none
+	int tempSet; //TEMP(LOAD) = set id, -1 for none
+};
+
+class SRsetCombination
+{
+	//LOAD or SPCADD bulk card: a set that combines other sets, scaled for LOAD
+public:
+	SRsetCombination(){ sid = -1; scale = 1.0; };
+	int sid;
+	double scale;
+	vector <int> sets;
+	vector <double> scales;
 };
 
 #endif // !defined(SRFORCE_INCLUDED)
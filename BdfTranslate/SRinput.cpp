@@ -24,10 +24,14 @@ also available at <https://www.gnu.org/licenses/>
 
 
 #include <stdlib.h>
+#include <stdarg.h>
 #include <search.h>
+#include <algorithm>
+#include <atomic>
 #include "SRmodel.h"
 #include "SRmachDep.h"
 #include "SRoutput.h"
+#include "SRparallel.h"
 
 extern SRmodel model;
 
@@ -36,7 +40,8 @@ extern SRmodel model;
 static char THIS_FILE[]=__FILE__;
 #endif
 
-static int SRuidDataCompareFunc(const void *v1, const void *v2);
+static void SRuidDataSort(SRvector <SRuidData>& uids, const char* entity);
+static SRindex SRuidDataFind(SRvector <SRuidData>& uids, int uid);
 
 SRinput::SRinput()
 {
@@ -56,6 +61,8 @@ SRinput::SRinput()
 	lastElPropId = -1;
 	lastElemUid = -1;
 	lastElemId = -1;
+	caseControlRead = false;
+	bdfSize = 0;
 }
 
 bool SRinput::Translate()
@@ -73,6 +80,7 @@ bool SRinput::Translate()
 	basename += tail;
 	filename = basename;
 
+	stats.Start();
 	if(!model.inpFile.Open(SRinputMode))
 	{
 		const char *tmp = filename.LastChar(slashChar, true);
@@ -80,19 +88,29 @@ bool SRinput::Translate()
 		OUTPRINT(" bdf file not found: %s", tmp);
 		exit(0);
 	}
+	//cards are read from a memory map of the bdf file, see SRfile::GetBdfLine:
+	if (!model.inpFile.Map())
+	{
+		SCREENPRINT(" bdf file could not be read: %s", model.inpFile.filename.getStr());
+		OUTPRINT(" bdf file could not be read: %s", model.inpFile.filename.getStr());
+		exit(0);
+	}
+	bdfSize = model.inpFile.mapSize;
 
 	//coordinates, materials and element properties will be read in on first pass for efficiency.
-	//they need to be stored and sorted for quick lookup during element input
-	model.Coords.Allocate(MAXNCOORD);
-	model.materials.Allocate(MAXNMAT);
-	model.elProps.Allocate(MAXNMAT);
+	//they need to be stored and sorted for quick lookup during element input.
+	//their number isn't known until the first pass is done, so their tables grow as they are read
 
 	if (!BdfInput())
 		return false;
 
 	//output:
+	if (model.renumberOutput)
+		model.output.Renumber();
 	model.mshFile.Open(SRoutputMode);
+	model.mshFile.StartAsyncWrite();
 	model.output.DoOutput();
+	stats.Phase("output");
 
 	nodeUids.Free();
 	elemUids.Free();
@@ -102,6 +120,109 @@ bool SRinput::Translate()
 	return true;
 }
 
+void SRinput::cardError(SRstring& line, const char* fmt, ...)
+{
+	//record an error in the bdf card just read, see addCardError
+	//input:
+		//line = the card
+		//fmt, ... = reason, printf style
+	char card[16];
+	cardName(line, card);
+	char reason[MAXLINELENGTH];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(reason, MAXLINELENGTH, fmt, args);
+	va_end(args);
+	addCardError(card, model.inpFile.bdfCardLine, reason);
+}
+
+void SRinput::cardName(SRstring& line, char* card)
+{
+	//name of a bdf card, without the large field marker, so "GRID*" is "GRID"
+	//input:
+		//line = the card
+	//output:
+		//card = card name, at most 15 characters; must hold 16
+	const char* s = line.getStr();
+	int n = 0;
+	while (n < 15 && s[n] != '\0' && s[n] != ' ' && s[n] != ',' && s[n] != '\t' && s[n] != '*')
+		n++;
+	STRNCPY(card, 16, s, n);
+}
+
+void SRinput::addCardError(const char* card, SRindex line, const char* reason)
+{
+	//record a card that could not be translated. the card is skipped; whether the translation
+	//goes on is decided by checkCardErrors
+	//input:
+		//card = card name
+		//line = line number of the card in the bdf file, 0 if not known
+		//reason = why the card could not be translated
+	SRcardError err;
+	err.card = card;
+	err.line = line;
+	err.reason = reason;
+	cardErrors.push_back(err);
+	if (line > 0)
+	{
+		OUTPRINT(" card error: %s, line " SRINDEXFMT ": %s", card, line, reason);
+		LOGPRINTLEVEL(logError, " card error: %s, line " SRINDEXFMT ": %s", card, line, reason);
+	}
+	else
+	{
+		OUTPRINT(" card error: %s: %s", card, reason);
+		LOGPRINTLEVEL(logError, " card error: %s: %s", card, reason);
+	}
+}
+
+bool SRinput::deckError(const char* card, const char* reason)
+{
+	//record an error in the deck as a whole, e.g. a model without nodes, see addCardError.
+	//the translation stops under either error policy
+	//input:
+		//card = name of the card that is missing or in error
+		//reason = what is wrong
+	//return:
+		//false, so the caller can return it
+	addCardError(card, 0, reason);
+	SCREENPRINT(" translation stopped: %s: %s, see xlate_errors.txt\n", card, reason);
+	return false;
+}
+
+bool SRinput::checkCardErrors()
+{
+	//check the card errors found so far against the error policy
+	//return:
+		//false if there are card errors and the translation has to stop, else true
+	//note:
+		//with the "onerror continue" option, the cards in error are skipped and the translation goes on
+	if (cardErrors.empty() || model.continueOnCardError)
+		return true;
+	SCREENPRINT(" translation stopped: %d card errors, see xlate_errors.txt\n", (int) cardErrors.size());
+	OUTPRINT(" translation stopped: %d card errors", (int) cardErrors.size());
+	return false;
+}
+
+void SRinput::writeCardErrors()
+{
+	//write the card errors, if any, to xlate_errors.txt in the working directory,
+	//one per line: card name, line number in the bdf file (0 if not known), reason
+	if (cardErrors.empty())
+		return;
+	SRstring name = model.wkdir;
+	name += "xlate_errors.txt";
+	SRfile f;
+	f.Delete(name.getStr());
+	if (!f.Open(SRoutputMode, name.getStr()))
+		return;
+	for (size_t i = 0; i < cardErrors.size(); i++)
+	{
+		SRcardError& err = cardErrors[i];
+		f.PrintLine("%s " SRINDEXFMT " %s", err.card.c_str(), err.line, err.reason.c_str());
+	}
+	f.Close();
+}
+
 int SRinput::GetMaterialId(SRstring &name)
 {
 	//look up the material id with "name"
@@ -134,8 +255,11 @@ int SRinput::GetCoordId(SRstring &name)
 	return -1;
 }
 
-void SRinput::SortOtherEntities()
+bool SRinput::SortOtherEntities()
 {
+	//sort the uids of coordinate systems, materials and element properties
+	//return:
+		//false if the model has no materials or no element properties, else true
 	SRuidData *nuid;
 	//sort "coordUids" array in ascending order of uid
 	int ncoord = model.Coords.GetNum();
@@ -151,31 +275,31 @@ void SRinput::SortOtherEntities()
 				nuid->id = i;
 				nuid->uid = coord->uid;
 			}
-			qsort(coordUids.GetVector(), ncoord, sizeof(SRuidData), SRuidDataCompareFunc);
+			SRuidDataSort(coordUids, "coordinate system");
 		}
 	}
 	//sort "matUids" array in ascending order of uid
+	//the offsets stay at their initial 0 if no card was read, so the counts are checked first:
+	int nmat = model.materials.GetNum();
+	if (nmat == 0)
+		return deckError("MAT1", "model has no materials");
+	int nelprop = model.elProps.GetNum();
+	if (nelprop == 0)
+		return deckError("PSOLID", "model has no solid element properties");
 	if (MatUidOffset == -1)
 	{
-		int nmat = model.materials.GetNum();
-		if (nmat > 0)
+		matUids.Allocate(nmat);
+		for (int i = 0; i < nmat; i++)
 		{
-			matUids.Allocate(nmat);
-			for (int i = 0; i < nmat; i++)
-			{
-				SRmaterial* mat = model.GetMaterial(i);
-				nuid = matUids.GetPointer(i);
-				nuid->id = i;
-				nuid->uid = mat->uid;
-			}
-			qsort(matUids.GetVector(), nmat, sizeof(SRuidData), SRuidDataCompareFunc);
+			SRmaterial* mat = model.GetMaterial(i);
+			nuid = matUids.GetPointer(i);
+			nuid->id = i;
+			nuid->uid = mat->uid;
 		}
-		else
-			ERROREXIT; //model has to have at least one mat prop
+		SRuidDataSort(matUids, "material");
 	}
 	//sort "elpropUids" array in ascending order of uid
 
-	int nelprop = model.elProps.GetNum();
 	for (int i = 0; i < nelprop; i++)
 	{
 		SRElProperty* prop = model.elProps.GetPointer(i);
@@ -186,70 +310,71 @@ void SRinput::SortOtherEntities()
 	if (elPropUidOffset == -1)
 	{
 		elpropUids.Allocate(nelprop);
-		if (nelprop > 0)
+		for (int i = 0; i < nelprop; i++)
 		{
-			for (int i = 0; i < nelprop; i++)
-			{
-				SRElProperty* prop = model.elProps.GetPointer(i);
-				nuid = elpropUids.GetPointer(i);
-				nuid->id = i;
-				nuid->uid = prop->uid;
-			}
-			qsort(elpropUids.GetVector(), nelprop, sizeof(SRuidData), SRuidDataCompareFunc);
+			SRElProperty* prop = model.elProps.GetPointer(i);
+			nuid = elpropUids.GetPointer(i);
+			nuid->id = i;
+			nuid->uid = prop->uid;
 		}
-		else
-			ERROREXIT; //model has to have at least one el prop
+		SRuidDataSort(elpropUids, "element property");
 	}
+	return true;
 }
 
-void SRinput::SortNodes()
+bool SRinput::SortNodes()
 {
+	//return:
+		//false if the model has no nodes, else true
 	SRuidData *nuid;
 	//fill node uid vector and sort in ascending order of uid for faster
 	//node-finding:
+	SRindex n = model.nodes.GetNum();
+	if (n == 0)
+		return deckError("GRID", "model has no nodes");
 	if (nodeUidOffset == -1)
 	{
-		int n = model.nodes.GetNum();
-		if (n == 0)
-			ERROREXIT;
 		nodeUids.Allocate(n);
-		for (int i = 0; i < n; i++)
+		for (SRindex i = 0; i < n; i++)
 		{
 			SRnode* node = model.GetNode(i);
 			nuid = nodeUids.GetPointer(i);
 			nuid->id = i;
 			nuid->uid = node->userId;
 		}
-		qsort(nodeUids.GetVector(), n, sizeof(SRuidData), SRuidDataCompareFunc);
+		SRuidDataSort(nodeUids, "node");
 	}
-
+	return true;
 }
 
-void SRinput::SortElements()
+bool SRinput::SortElements()
 {
+	//return:
+		//false if the model has no solid elements, else true
 	SRuidData *nuid;
 
 	//fill elem uid vector and sort in ascending order of uid for faster
 	//elem-finding:
+	SRindex n = model.elements.GetNum();
+	if (n == 0)
+		return deckError("CTETRA/CPENTA/CHEXA", "model has no solid elements");
 	if (elemUidOffSet == -1)
 	{
-		int n = model.elements.GetNum();
-		if (n == 0)
-			ERROREXIT;
 		elemUids.Allocate(n);
-		for (int i = 0; i < n; i++)
+		for (SRindex i = 0; i < n; i++)
 		{
 			SRelement* elem = model.GetElement(i);
 			nuid = elemUids.GetPointer(i);
 			nuid->id = i;
 			nuid->uid = elem->uid;
 		}
-		qsort(elemUids.GetVector(), n, sizeof(SRuidData), SRuidDataCompareFunc);
+		SRuidDataSort(elemUids, "element");
 	}
+	return true;
 }
 
 
-int SRinput::NodeFind(int uid)
+SRindex SRinput::NodeFind(int uid)
 {
 	//find node with user Id uid
 	//input:
@@ -257,28 +382,50 @@ int SRinput::NodeFind(int uid)
 	//return:
 	//number of the node that matches uid, -1 if not found
 
-	int id = -1;
+	if (nodeUidOffset != -1)
+		return NodeLookup(uid);
+	if (uid == lastNodeUid)
+		return lastNodeId;
+	SRindex id = NodeLookup(uid);
+	lastNodeId = id;
+	lastNodeUid = uid;
+	return id;
+}
 
-	//binary search:
+SRindex SRinput::NodeLookup(int uid)
+{
+	//find node with user Id uid, same as NodeFind but without the last-found cache,
+	//so it can be called from parallel loops
+	//input:
+	//uid = user id to match
+	//return:
+	//number of the node that matches uid, -1 if not found
+
+	SRindex id = -1;
 	if (nodeUidOffset != -1)
-		return uid - nodeUidOffset;
-	else if (uid == lastNodeUid)
-		id = lastNodeId;
-	else
 	{
-		SRuidData* nuid;
-		SRuidData uidt;
-		//"search key" has to be same data type expected by compare function see SRuidDataCompareFunc:
-		uidt.uid = uid;
-		nuid = (SRuidData *)bsearch(&uidt, nodeUids.GetVector(), nodeUids.GetNum(), sizeof(SRuidData), SRuidDataCompareFunc);
-		if (nuid != NULL)
-			id = nuid->id;
+		//uids of nodes in model are contiguous but uid may be for a node that is not in the model (e.g. cropped):
+		id = uid - nodeUidOffset;
+		if (id < 0 || id >= model.GetNumNodes())
+			id = -1;
+		return id;
 	}
-	lastNodeId = id;
-	lastNodeUid = uid;
+	//binary search:
+	id = SRuidDataFind(nodeUids, uid);
 	return id;
 }
 
+bool SRinput::isOrphanNode(int uid)
+{
+	//same as SRmodel::checkOrphanNode but without the last-found cache, so it can be called from parallel loops
+	//return:
+		//true if there is no node with user id uid or it is not used by any element
+	SRindex nid = NodeLookup(uid);
+	if (nid == -1)
+		return true;
+	return model.GetNode(nid)->isOrphan();
+}
+
 
 int SRinput::CoordFind(int uid)
 {
@@ -297,13 +444,7 @@ int SRinput::CoordFind(int uid)
 	{
 		//binary search:
 		
-		SRuidData* nuid;
-		SRuidData uidt;
-		//"search key" has to be same data type expected by compare function see SRuidDataCompareFunc:
-		uidt.uid = uid;
-		nuid = (SRuidData *)bsearch(&uidt, coordUids.GetVector(), coordUids.GetNum(), sizeof(SRuidData), SRuidDataCompareFunc);
-		if (nuid != NULL)
-			id = nuid->id;
+		id = SRuidDataFind(coordUids, uid);
 	}
 	lastCoordId = id;
 	lastCoordUid = uid;
@@ -326,13 +467,7 @@ int SRinput::MatFind(int uid)
 	{
 		//binary search:
 		
-		SRuidData* nuid;
-		SRuidData uidt;
-		//"search key" has to be same data type expected by compare function see SRuidDataCompareFunc:
-		uidt.uid = uid;
-		nuid = (SRuidData *)bsearch(&uidt, matUids.GetVector(), matUids.GetNum(), sizeof(SRuidData), SRuidDataCompareFunc);
-		if (nuid != NULL)
-			id = nuid->id;
+		id = SRuidDataFind(matUids, uid);
 	}
 	lastMatId = id;
 	lastMatUid = uid;
@@ -355,20 +490,14 @@ int SRinput::ElpropFind(int uid)
 	else
 	{
 		//binary search:
-		SRuidData* nuid;
-		SRuidData uidt;
-		//"search key" has to be same data type expected by compare function see SRuidDataCompareFunc:
-		uidt.uid = uid;
-		nuid = (SRuidData *)bsearch(&uidt, elpropUids.GetVector(), elpropUids.GetNum(), sizeof(SRuidData), SRuidDataCompareFunc);
-		if (nuid != NULL)
-			id = nuid->id;
+		id = SRuidDataFind(elpropUids, uid);
 	}
 	lastElPropId = id;
 	lastElPropUid = uid;
 	return id;
 }
 
-int SRinput::ElemFind(int uid)
+SRindex SRinput::ElemFind(int uid)
 {
 	//find elem with user Id uid
 	//input:
@@ -376,13 +505,9 @@ int SRinput::ElemFind(int uid)
 	//return:
 		//number of the elem. that matches uid, -1 if not found
 
-	int id = -1;
+	SRindex id;
 	if (elemUidOffSet != -1)
-	{
-		id = uid - elemUidOffSet;
-		if (id >= model.GetNumElements())
-			id = -1;
-	}
+		id = ElemLookup(uid);
 	else if (uid == lastElemUid)
 	{
 		id = lastElemId;
@@ -390,21 +515,34 @@ int SRinput::ElemFind(int uid)
 			id = -1;
 	}
 	else
-	{
-		//binary search:
-		SRuidData* nuid;
-		SRuidData uidt;
-		//"search key" has to be same data type expected by compare function see SRuidDataCompareFunc:
-		uidt.uid = uid;
-		nuid = (SRuidData *)bsearch(&uidt, elemUids.GetVector(), elemUids.GetNum(), sizeof(SRuidData), SRuidDataCompareFunc);
-		if (nuid != NULL)
-			id = nuid->id;
-	}
+		id = ElemLookup(uid);
 	lastElemId = id;
 	lastElemUid = uid;
 	return id;
 }
 
+SRindex SRinput::ElemLookup(int uid)
+{
+	//find elem with user Id uid, same as ElemFind but without the last-found cache,
+	//so it can be called from parallel loops
+	//input:
+		//uid = user id to match
+	//return:
+		//number of the elem. that matches uid, -1 if not found
+
+	SRindex id = -1;
+	if (elemUidOffSet != -1)
+	{
+		id = uid - elemUidOffSet;
+		if (id < 0 || id >= model.GetNumElements())
+			id = -1;
+		return id;
+	}
+	//binary search:
+	id = SRuidDataFind(elemUids, uid);
+	return id;
+}
+
 void SRinput::checkLcs(SRconstraint* con, int cid)
 {
 	if (cid == -1)
@@ -466,124 +604,90 @@ void SRinput::checkLcs(SRconstraint* con, int cid)
 	con->coordId = cid;
 }
 
+unsigned SRinput::elemCornerMask(SRelement* elem, int gid)
+{
+	//mask of the local corner nodes of an element whose user id is gid
+	//return:
+		//bit i is set if corner node i of elem is gid
+	int nc = 8;
+	if (elem->type == tet)
+		nc = 4;
+	else if (elem->type == wedge)
+		nc = 6;
+	unsigned m = 0;
+	for (int i = 0; i < nc; i++)
+	{
+		if (elem->nodeUIds.Get(i) == gid)
+			m |= (1u << i);
+	}
+	return m;
+}
+
 int SRinput::findElemFace(bool needMidSide, SRelement* elem, int g1, int g2, int gout[8], double *pv)
 {
-	//for a quad face, find all for nodes for face that matches diag corners g1,g2
+	//for a quad face, find all for nodes for face that matches diag corners g1,g2.
+	//for a tet, find the face that has g1 on it but not g2. for a wedge with g2 = -1, find the tri face with g1
+	//note:
+		//the masks of corner nodes on each local face are precomputed (SRmodel::mapSetup) so this is a
+		//fixed number of bit tests per face, independent of the model.
+		//the face chosen when more than one matches is the same as the original face-by-face search:
+		//the first matching face, unless a later matching face starts at g1. for wedge tri faces the last match
+
 	int ncorner = -1;
 	int nv[8];
 	int nn;
-	if (elem->type == brick)
+	SRelementType type = elem->type;
+	unsigned m1 = elemCornerMask(elem, g1);
+	if (m1 == 0)
+		return -1;
+	unsigned m2 = 0;
+	if (g2 != -1)
+		m2 = elemCornerMask(elem, g2);
+	int lf0 = 0, lf1 = 0;
+	bool g2OnFace = true;
+	if (type == brick)
+		lf1 = 6;
+	else if (type == tet)
 	{
-		for (int lf = 0; lf < 6; lf++)
-		{
-			nn = elem->GetFaceNodes(needMidSide, lf, nv);
-			for (int i = 0; i < nn; i++)
-			{
-				if (g1 == nv[i])
-				{
-					for (int j = 0; j < nn; j++)
-					{
-						if (g2 == nv[j])
-						{
-							ncorner = nn;
-							if (needMidSide)
-								nn *= 2;
-							for (int k = 0; k < nn * 2; k++)
-								gout[k] = nv[k];
-							break;
-						}
-					}
-				}
-				if (ncorner != -1)
-					break;
-			}
-		}
+		lf1 = 4;
+		g2OnFace = false;
 	}
-	else if (elem->type == wedge)
+	else if (type == wedge)
 	{
 		if (g2 == -1)
-		{
-			//search for match on tri face:
-			for (int lf = 0; lf < 2; lf++)
-			{
-				nn = elem->GetFaceNodes(needMidSide, lf, nv);
-				for (int i = 0; i < nn; i++)
-				{
-					if (g1 == nv[i])
-					{
-						ncorner = 3;
-						if (needMidSide)
-							nn *= 2;
-						for (int k = 0; k < nn * 2; k++)
-							gout[k] = nv[k];
-						break;
-					}
-				}
-			}
-		}
+			lf1 = 2;
 		else
 		{
-			//search for match on quad face:
-			for (int lf = 2; lf < 5; lf++)
-			{
-				nn = elem->GetFaceNodes(needMidSide, lf, nv);
-				for (int i = 0; i < nn; i++)
-				{
-					if (g1 == nv[i])
-					{
-						for (int j = 0; j < nn; j++)
-						{
-							if (g2 == nv[j])
-							{
-								ncorner = nn;
-								if (needMidSide)
-									nn *= 2;
-								for (int k = 0; k < nn * 2; k++)
-									gout[k] = nv[k];
-								break;
-							}
-						}
-					}
-					if (ncorner != -1)
-						break;
-				}
-			}
+			lf0 = 2;
+			lf1 = 5;
 		}
 	}
-	else if (elem->type == tet)
+	int lface = -1;
+	for (int lf = lf0; lf < lf1; lf++)
 	{
-		for (int lf = 0; lf < 4; lf++)
+		unsigned fm = model.GetElementLocalFaceCornerMask(lf, type);
+		if ((fm & m1) == 0)
+			continue;
+		if (type == wedge && g2 == -1)
 		{
-			nn = elem->GetFaceNodes(needMidSide, lf, nv);
-			for (int i = 0; i < 3; i++)
-			{
-				if (g1 == nv[i])
-				{
-					int g2NotOnFace = true;
-					for (int j = 0; j < 3; j++)
-					{
-						if (g2 == nv[j])
-						{
-							g2NotOnFace = false;
-							break;
-						}
-					}
-					if (g2NotOnFace)
-					{
-						ncorner = 3;
-						if (needMidSide)
-							nn *= 2;
-						for (int k = 0; k < nn; k++)
-							gout[k] = nv[k];
-						gout[6] = -1;
-						break;
-					}
-
-				}
-				if (ncorner != -1)
-					break;
-			}
+			lface = lf;
+			continue;
 		}
+		if (((fm & m2) != 0) != g2OnFace)
+			continue;
+		if (lface == -1 || (m1 & (1u << model.GetElementLocalFaceFirstNode(lf, type))) != 0)
+			lface = lf;
+	}
+	if (lface != -1)
+	{
+		nn = elem->GetFaceNodes(needMidSide, lface, nv);
+		ncorner = nn;
+		if (needMidSide)
+			nn *= 2;
+		for (int k = 0; k < nn; k++)
+			gout[k] = nv[k];
+		if (type == tet)
+			gout[6] = -1;
 	}
 
 	if (pv != NULL)
@@ -610,64 +714,353 @@ int SRinput::findElemFace(bool needMidSide, SRelement* elem, int g1, int g2, int
 
 void SRinput::SetNodeElmentOwners()
 {
-	for (int e = 0; e < model.GetNumElements(); e++)
+	//build the node to element adjacency of the model, see SRmodel::nodeElemStart, and set the
+	//first element owner of each node, so orphan nodes can be found
+	//note:
+		//two passes over the elements, count then fill, split into chunks that run in parallel.
+		//the rows are sorted afterward so the elements of each node are in ascending order
+
+	SRindex nnode = model.GetNumNodes();
+	SRindex nelem = model.GetNumElements();
+	model.nodeElemStart.Allocate(nnode + 1);
+	SRindex* start = model.nodeElemStart.GetVector();
+	vector <atomic <int> > counts(nnode);
+	SRparallel::For(nnode, FINISHCHUNKSIZE, [&](int c, long long begin, long long end)
 	{
-		SRelement* elem = model.GetElement(e);
-		elem->SetNodeElmentOwners();
+		for (SRindex n = begin; n < end; n++)
+			counts[n].store(0, memory_order_relaxed);
+	});
+	//node ids of the elements, found once for both passes:
+	vector <SRindex> elemNodeStart(nelem + 1);
+	elemNodeStart[0] = 0;
+	for (SRindex e = 0; e < nelem; e++)
+		elemNodeStart[e + 1] = elemNodeStart[e] + model.GetElement(e)->GetNumNodes();
+	vector <SRindex> elemNodes(elemNodeStart[nelem]);
+	SRparallel::For(nelem, FINISHCHUNKSIZE, [&](int c, long long begin, long long end)
+	{
+		for (SRindex e = begin; e < end; e++)
+		{
+			SRelement* elem = model.GetElement(e);
+			SRindex* enodes = &elemNodes[elemNodeStart[e]];
+			for (int i = 0; i < elem->GetNumNodes(); i++)
+			{
+				SRindex nid = NodeLookup(elem->nodeUIds.Get(i));
+				//an element is listed once per node even if it repeats the node (e.g. collapsed elements):
+				for (int j = 0; j < i; j++)
+				{
+					if (enodes[j] == nid)
+						nid = -1;
+				}
+				enodes[i] = nid;
+				if (nid != -1)
+					counts[nid].fetch_add(1, memory_order_relaxed);
+			}
+		}
+	});
+	start[0] = 0;
+	for (SRindex n = 0; n < nnode; n++)
+	{
+		start[n + 1] = start[n] + counts[n].load(memory_order_relaxed);
+		counts[n].store(0, memory_order_relaxed);
 	}
+	model.nodeElems.Allocate(start[nnode]);
+	SRindex* nodeElems = model.nodeElems.GetVector();
+	SRparallel::For(nelem, FINISHCHUNKSIZE, [&](int c, long long begin, long long end)
+	{
+		for (SRindex e = begin; e < end; e++)
+		{
+			for (SRindex i = elemNodeStart[e]; i < elemNodeStart[e + 1]; i++)
+			{
+				SRindex nid = elemNodes[i];
+				if (nid != -1)
+					nodeElems[start[nid] + counts[nid].fetch_add(1, memory_order_relaxed)] = e;
+			}
+		}
+	});
+	SRparallel::For(nnode, FINISHCHUNKSIZE, [&](int c, long long begin, long long end)
+	{
+		for (SRindex n = begin; n < end; n++)
+		{
+			sort(nodeElems + start[n], nodeElems + start[n + 1]);
+			SRnode* node = model.GetNode(n);
+			if (start[n + 1] > start[n])
+				node->firstElementOwner = nodeElems[start[n]];
+			else
+				node->firstElementOwner = -1;
+		}
+	});
 }
 
 bool SRinput::IsWedgeFaceQuad(SRelement* elem, int gid[])
 {
 	//from 1st 3 nodes of a wedge face, find local face and see if it is a quad
-	int nv[4];
+	//note:
+		//the first local face with all 3 nodes on it is used. see findElemFace for the corner masks
+	unsigned m[3];
+	for (int j = 0; j < 3; j++)
+		m[j] = elemCornerMask(elem, gid[j]);
 	for (int lf = 0; lf < 5; lf++)
 	{
-		int nn = elem->GetFaceNodes(false, lf, nv);
+		unsigned fm = model.GetElementLocalFaceCornerMask(lf, wedge);
 		int nmatches = 0;
 		for (int j = 0; j < 3; j++)
+			nmatches += SRbitVector::CountBits(m[j] & fm);
+		if (nmatches >= 3)
+			return (lf >= 2);
+	}
+	return false;
+}
+
+
+static void SRuidDataSort(SRvector <SRuidData>& uids, const char* entity)
+{
+	//sort uid data in ascending order of uid with a least significant digit radix sort, 8 bits per pass.
+	//the sort is stable, so entries with the same uid stay in order of id. duplicate uids are reported
+	//input:
+		//uids = uid data to sort
+		//entity = name of the entity type, for the duplicate report
+	//output:
+		//uids = sorted
+	//note:
+		//each pass counts digits per chunk and scatters each chunk into its own slots, so the chunks
+		//run in parallel. passes in which every uid has the same digit are skipped, so for typical
+		//uids only the low 2 or 3 bytes take a pass
+
+	SRindex n = uids.GetNum();
+	if (n < 2)
+		return;
+	SRuidData* src = uids.GetVector();
+	vector <SRuidData> temp(n);
+	SRuidData* dst = temp.data();
+	int nchunk = SRparallel::GetNumChunks(n, UIDSORTCHUNKSIZE);
+	vector <SRindex> counts(nchunk * 256);
+	for (int shift = 0; shift < 32; shift += 8)
+	{
+		//the sign bit is flipped so negative uids sort first:
+		auto digit = [shift](int uid) { return (int) (((((unsigned) uid) ^ 0x80000000u) >> shift) & 0xff); };
+		fill(counts.begin(), counts.end(), 0);
+		SRparallel::For(n, UIDSORTCHUNKSIZE, [&](int c, long long begin, long long end)
 		{
-			for (int i = 0; i < nn; i++)
-			{
-				if (gid[j] == nv[i])
-				{
-					nmatches++;
-					if (nmatches == 3)
-						break;
-				}
-			}
-			if (nmatches == 3)
+			SRindex* count = &counts[c * 256];
+			for (SRindex i = begin; i < end; i++)
+				count[digit(src[i].uid)]++;
+		});
+		int d0 = digit(src[0].uid);
+		SRindex nd0 = 0;
+		for (int c = 0; c < nchunk; c++)
+			nd0 += counts[c * 256 + d0];
+		if (nd0 == n)
+			continue;
+		//starting slot of each digit in each chunk; chunks follow each other within a digit to keep the sort stable:
+		SRindex offset = 0;
+		for (int b = 0; b < 256; b++)
+		{
+			for (int c = 0; c < nchunk; c++)
 			{
-				if (lf < 2)
-					return false;
-				else
-					return true;
+				SRindex count = counts[c * 256 + b];
+				counts[c * 256 + b] = offset;
+				offset += count;
 			}
 		}
+		SRparallel::For(n, UIDSORTCHUNKSIZE, [&](int c, long long begin, long long end)
+		{
+			SRindex* slot = &counts[c * 256];
+			for (SRindex i = begin; i < end; i++)
+				dst[slot[digit(src[i].uid)]++] = src[i];
+		});
+		swap(src, dst);
 	}
-	return false;
+	if (src != uids.GetVector())
+		copy(src, src + n, uids.GetVector());
 
+	//report duplicate uids, they are adjacent now. finding a duplicate uid returns its first entity:
+	SRuidData* d = uids.GetVector();
+	SRindex ndup = 0;
+	for (SRindex i = 1; i < n; i++)
+	{
+		if (d[i].uid != d[i - 1].uid)
+			continue;
+		if (ndup < 10)
+			LOGPRINT(" duplicate %s id: %d", entity, d[i].uid);
+		ndup++;
+	}
+	if (ndup > 10)
+		LOGPRINT(" %d duplicate %s ids in all", (int) ndup, entity);
 }
 
-
-static int SRuidDataCompareFunc(const void *v1, const void *v2)
+static SRindex SRuidDataFind(SRvector <SRuidData>& uids, int uid)
 {
-	//compare function for sorting and searching of node userids
+	//find uid in uid data sorted by SRuidDataSort
 	//input:
-	//v1 = pointer to uid data for node 1
-	//v2 = pointer to uid data for node 2
+		//uids = sorted uid data
+		//uid = user id to match
 	//return:
-	//-1 if node1 uid is less than node2 uid
-	//0  if node1 uid is equal to node2 uid
-	//+1 if node1 uid is greater than node2 uid
+		//id of the first entry that matches uid, -1 if not found, or if uids has not been filled yet
 
-	SRuidData* node1 = (SRuidData*)v1;
-	SRuidData* node2 = (SRuidData*)v2;
-	if (node1->uid < node2->uid)
+	if (uids.isEmpty())
 		return -1;
-	else if (node1->uid == node2->uid)
-		return 0;
-	else
-		return 1;
+	SRuidData* d = uids.GetVector();
+	SRindex lo = 0;
+	SRindex hi = uids.GetNum();
+	while (lo < hi)
+	{
+		SRindex mid = lo + (hi - lo) / 2;
+		if (d[mid].uid < uid)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < uids.GetNum() && d[lo].uid == uid)
+		return d[lo].id;
+	return -1;
+}
+
+void SRinput::countKeptEntities()
+{
+	//for --stats: count GRID and solid element cards that were read but are not in the .msh file,
+	//because they were cropped, broken out, or are orphans
+	//note:
+		//called after finishForces and finishConstraints, when the model holds only the entities to output.
+		//cards with errors are not in the model either; SRstats::Write takes them out of dropped
+	SRindex numNodesKept = 0;
+	for (SRindex n = 0; n < model.GetNumNodes(); n++)
+	{
+		if (!model.GetNode(n)->isOrphan())
+			numNodesKept++;
+	}
+	SRindex numElemsKept[3] = { 0, 0, 0 };
+	for (SRindex e = 0; e < model.GetNumElements(); e++)
+	{
+		SRelementType type = model.GetElement(e)->type;
+		if (type != undefined)
+			numElemsKept[type]++;
+	}
+	const char* cards[4] = { "GRID", "CTETRA", "CPENTA", "CHEXA" };
+	SRindex kept[4] = { numNodesKept, numElemsKept[tet], numElemsKept[wedge], numElemsKept[brick] };
+	for (int i = 0; i < 4; i++)
+	{
+		SRcardStat& st = stats.Get(cards[i]);
+		if (st.count > kept[i])
+			st.dropped = st.count - kept[i];
+	}
+}
+
+void SRstats::Start()
+{
+	//start the clock for the whole translation and its first phase
+	if (!on)
+		return;
+	startTime = chrono::steady_clock::now();
+	phaseStart = startTime;
+	lastCard = NULL;
+	lastCardPos = 0;
+	bdfBytes = 0;
+}
+
+void SRstats::Phase(const char* name)
+{
+	//record the time since the end of the previous phase
+	//input:
+		//name = phase that just ended
+	if (!on)
+		return;
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	phaseNames.push_back(name);
+	phaseSeconds.push_back(chrono::duration<double>(now - phaseStart).count());
+	phaseStart = now;
+}
+
+SRcardStat* SRstats::StartCard(SRstring* line, long long pos)
+{
+	//count a card read in the 2nd pass and start timing its parse
+	//input:
+		//line = the card, NULL at end of file
+		//pos = offset of the card in the bdf file, the file size at end of file
+	//return:
+		//statistics of the card type, NULL at end of file
+	//note:
+		//the size of a card is only known when the next one is read, so the bytes of the previous
+		//card are added here
+	if (lastCard != NULL)
+		lastCard->bytes += pos - lastCardPos;
+	lastCardPos = pos;
+	lastCard = NULL;
+	if (line == NULL)
+	{
+		bdfBytes = pos;
+		return NULL;
+	}
+	char card[16];
+	SRinput::cardName(*line, card);
+	if (card[0] == '$')
+		card[1] = '\0'; //all comments in one row
+	SRcardStat* st = &cards[card];
+	st->count++;
+	lastCard = st;
+	cardStart = chrono::steady_clock::now();
+	return st;
 }
 
+void SRstats::EndCard(SRcardStat* st)
+{
+	//add the parse time of the card started by StartCard
+	//input:
+		//st = statistics returned by StartCard, NULL for none
+	if (st == NULL)
+		return;
+	st->seconds += chrono::duration<double>(chrono::steady_clock::now() - cardStart).count();
+}
+
+void SRstats::Write()
+{
+	//write the card statistics and phase times to wkdir/xlate_stats.txt
+	if (!on)
+		return;
+	Phase("total");
+	phaseSeconds.back() = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+	for (size_t i = 0; i < model.input.cardErrors.size(); i++)
+		cards[model.input.cardErrors[i].card].errors++;
+	//countKeptEntities ran before the errors were counted:
+	const char* solidCards[4] = { "GRID", "CTETRA", "CPENTA", "CHEXA" };
+	for (int i = 0; i < 4; i++)
+	{
+		SRcardStat& st = cards[solidCards[i]];
+		st.dropped -= (st.dropped >= st.errors ? st.errors : st.dropped);
+	}
+
+	SRstring name = model.wkdir;
+	name += "xlate_stats.txt";
+	SRfile f;
+	f.SetFileName(name);
+	f.Delete();
+	if (!f.Open(SRoutputMode))
+		return;
+	f.PrintLine("bdf translate statistics model %s", model.fileNameTail.getStr());
+	f.PrintLine("%-10s %12s %14s %10s %10s %10s %8s", "card", "count", "bytes", "parse s", "rejected", "dropped", "errors");
+	SRcardStat total;
+	for (map <string, SRcardStat>::iterator it = cards.begin(); it != cards.end(); ++it)
+	{
+		SRcardStat& st = it->second;
+		if (st.count == 0 && st.rejected == 0 && st.dropped == 0 && st.errors == 0)
+			continue;
+		f.PrintLine("%-10s %12lld %14lld %10.3f %10lld %10lld %8lld", it->first.c_str(), (long long) st.count, st.bytes,
+			st.seconds, (long long) st.rejected, (long long) st.dropped, (long long) st.errors);
+		total.count += st.count;
+		total.bytes += st.bytes;
+		total.seconds += st.seconds;
+		total.rejected += st.rejected;
+		total.dropped += st.dropped;
+		total.errors += st.errors;
+	}
+	f.PrintLine("%-10s %12lld %14lld %10.3f %10lld %10lld %8lld", "total", (long long) total.count, total.bytes,
+		total.seconds, (long long) total.rejected, (long long) total.dropped, (long long) total.errors);
+	f.PrintLine("");
+	f.PrintLine("%-24s %10s", "phase", "seconds");
+	for (size_t i = 0; i < phaseNames.size(); i++)
+		f.PrintLine("%-24s %10.3f", phaseNames[i].c_str(), phaseSeconds[i]);
+	double mb = bdfBytes / 1.0e6;
+	double seconds = phaseSeconds.back();
+	f.PrintLine("");
+	f.PrintLine("bdf size %.1f MB, throughput %.1f MB/s", mb, seconds > 0.0 ? mb / seconds : 0.0);
+	f.Close();
+}
@@ -24,23 +24,115 @@ also available at <https://www.gnu.org/licenses/>
 #if !defined(SRINPUT_INCLUDED)
 #define SRINPUT_INCLUDED
 
+#include <map>
+#include <chrono>
 #include "SRfile.h"
 #include "SRstring.h"
 
+class SRsubcase;
+
+//smallest piece of the displacement file worth giving to a thread:
+#define DISPCHUNKSIZE (4 * 1024 * 1024)
+//smallest number of nodes, forces, constraints or unsupported entities worth giving to a thread in the finish stages:
+#define FINISHCHUNKSIZE 2048
+//smallest number of uids worth giving to a thread when sorting uid indexes:
+#define UIDSORTCHUNKSIZE (64 * 1024)
+
 struct SRuidData
 {
-	int id;
+	SRindex id;
 	int uid;
 };
 
+struct SRdispFileChunk
+{
+	//rows of the displacement file read by one thread, see SRinput::scanDispFile
+	vector <int> uids; //leading node id of each row read
+	vector <long long> spans; //begin, end offsets of runs of accepted rows
+	bool stopped; //true if a row without a node id was encountered; reading stops there
+};
+
+//card index sidecar of a bdf file, see SRinput::readBdfIndex:
+#define BDFINDEXVERSION 1
+
+enum SRbdfRegion { gridRegion, elementRegion, loadRegion, constraintRegion, numBdfRegions };
+
+struct SRbdfIndexCard
+{
+	long long pos; //offset of the card in the bdf file
+	SRindex line; //line number of the card
+	SRindex seq; //number of cards read in the counting pass up to and including this one
+};
+
+class SRbdfIndex
+{
+	//what the counting pass of SRinput::BdfInput learns from a bdf file, so a later translation of the
+	//same file can skip it
+public:
+	SRbdfIndex();
+	long long fileSize;
+	unsigned long long hash; //see SRfile::MapHash
+	SRindex nnode, nelem, nforce, nvol, ntherm, nspcd, ncon, numunsup;
+	bool linearMesh;
+	bool isNx;
+	//offsets of the first and last card of each region, -1 if there are none. split points for chunked reading:
+	long long regionFirst[numBdfRegions];
+	long long regionLast[numBdfRegions];
+	//coordinate, material, property and set combination cards and material name comments,
+	//which the counting pass reads:
+	vector <SRbdfIndexCard> setupCards;
+};
+
+struct SRcardError
+{
+	//a card that could not be translated, see SRinput::addCardError
+	string card; //card name
+	SRindex line; //line number of the card in the bdf file, 0 if not known
+	string reason;
+};
+
+struct SRcardStat
+{
+	//statistics of one card type, see SRstats
+	SRcardStat(){ count = 0; bytes = 0; seconds = 0.0; rejected = 0; dropped = 0; errors = 0; };
+	SRindex count; //cards read in the 2nd pass
+	long long bytes; //bytes of the cards in the bdf file, including continuation lines
+	double seconds; //time spent parsing the cards
+	SRindex rejected; //forces or constraints rejected in finishForces or finishConstraints
+	SRindex dropped; //cards whose content is not in the .msh file: orphan or cropped entities, unsupported cards
+	SRindex errors; //card errors, see SRinput::addCardError
+};
+
+class SRstats
+{
+	//card type statistics and phase times of a translation, written to xlate_stats.txt with --stats
+public:
+	SRstats(){ on = false; };
+	void Start();
+	void Phase(const char* name);
+	SRcardStat* StartCard(SRstring* line, long long pos);
+	void EndCard(SRcardStat* st);
+	SRcardStat& Get(const char* card){ return cards[card]; };
+	void Write();
+
+	bool on;
+	map <string, SRcardStat> cards;
+	vector <string> phaseNames;
+	vector <double> phaseSeconds;
+	chrono::steady_clock::time_point startTime, phaseStart, cardStart;
+	SRcardStat* lastCard; //card whose bytes end at the next card, see StartCard
+	long long lastCardPos;
+	long long bdfBytes; //size of the bdf file
+};
+
 class SRinput  
 {
 public:
 	SRinput();
 	bool Translate();
-	void SortOtherEntities();
-	void SortNodes();
-	void SortElements();
+	bool SortOtherEntities();
+	bool SortNodes();
+	bool SortElements();
 	int GetCoordId(SRstring& name);
 	int GetMaterialId(SRstring& name);
 	void InputConstraint(SRstring& line);
@@ -50,18 +142,37 @@ public:
 	void InputForce(SRstring& line);
 	void InputElementProperty(SRstring& line);
 	void InputMaterial(SRstring& line, bool matNameWasRead, SRstring& matname);
-	void InputElement(SRstring& line, int& numFaces);
+	void InputElement(SRstring& line, SRindex& numFaces);
 	void InputNode(SRstring& line);
 	void InputEnfd(SRstring& line);
-	void finishUnsup();
-	void cropElements();
-	void finishForces();
+	bool finishUnsup();
+	void readDispNodes();
+	bool cropCheckElement(SRstring& line, bool checkLinear);
+	bool cropBsurfOnlyElements();
+	bool breakoutModel();
+	void selectBreakoutElements();
+	void removeOrphanNodes();
+	void setActiveMaterials();
+	void writeSrrDisps();
+	bool scanDispFile(bool deckNodesOnly, vector <SRdispFileChunk>& chunks);
+	bool resolveCoords();
+	bool resolveCoord(int c, vector <char>& state, vector <int>& nodeCoords);
+	bool coordError(SRcoord* coord, const char* fmt, ...);
+	void transformLcsNodes();
+	bool finishForces();
+	bool finishForce(SRforce* force, bool& badCoord);
+	bool finishUnsupNodes(SRunsup* unsup, vector <SRindex>& nids, int& badUid);
+	bool finishVolumeForces();
+	void finishTemps();
 	void finishConstraints();
-	int NodeFind(int uid);
+	SRindex NodeFind(int uid);
+	SRindex NodeLookup(int uid);
+	bool isOrphanNode(int uid);
 	int CoordFind(int uid);
 	int MatFind(int uid);
 	int ElpropFind(int uid);
-	int ElemFind(int uid);
+	SRindex ElemFind(int uid);
+	SRindex ElemLookup(int uid);
 	int findElemFace(bool needMidSide, SRelement* elem, int g1, int g2, int gout[8], double *fv = NULL);
 	void CountEntities(int &num);
 	void checkLcs(SRconstraint* con, int cid);
@@ -69,11 +180,27 @@ public:
 	void inputUnsupported(SRstring &line);
 	int findFaceNodes(SRelement* elem, int gidv[], int& nread, int gidFace[]);
 	bool IsWedgeFaceQuad(SRelement* elem, int gid[]);
+	unsigned elemCornerMask(SRelement* elem, int gid);
 	void checkUnsupportedTouchesNonOrphan();
+	void mergeCoincidentNodes();
 
 	//BDF Specific:
-	void TopToBulk();
+	bool TopToBulk();
+	void readCaseControl(SRstring& line, SRsubcase& defaults);
+	bool isLoadCombination(SRstring& line);
+	void InputSetCombination(SRstring& line);
 	bool BdfInput();
+	void cardError(SRstring& line, const char* fmt, ...);
+	void addCardError(const char* card, SRindex line, const char* reason);
+	bool deckError(const char* card, const char* reason);
+	bool checkCardErrors();
+	void writeCardErrors();
+	static void cardName(SRstring& line, char* card);
+	void countKeptEntities();
+	void bdfIndexFileName(SRstring& name);
+	void indexBdfCard(SRbdfIndex& index, SRstring& line, bool isComment, bool isMat, SRindex seq);
+	bool readBdfIndex(SRbdfIndex& index);
+	void writeBdfIndex(SRbdfIndex& index);
 
 	SRvector <SRuidData> nodeUids;
 	SRvector <SRuidData> coordUids;
@@ -86,7 +213,7 @@ public:
 	int elPropUidOffset;
 	int elemUidOffSet;
 	int lastNodeUid;
-	int lastNodeId;
+	SRindex lastNodeId;
 	int lastCoordUid;
 	int lastCoordId;
 	int lastMatUid;
@@ -94,11 +221,22 @@ public:
 	int lastElPropUid;
 	int lastElPropId;
 	int lastElemUid;
-	int lastElemId;
-	int nnode;
-	int nelem;
+	SRindex lastElemId;
+	SRindex nnode;
+	SRindex nelem;
+	bool caseControlRead;
+	vector <SRcardError> cardErrors; //cards that could not be translated, in the order found
+	SRstats stats;
+	long long bdfSize; //size of the bdf file in bytes
 //bdf specific
-	bool anyCoordsReferenceGrids;
+	//for cropping with displacement nodes:
+	SRbitVector dispNodeUids; //nodes in the displacement file
+	SRbitVector deckNodeUids; //all GRIDs in the bdf file
+	SRbitVector cropNodeUids; //nodes of elements that survive the crop
+	SRbitVector bsurfIds; //ids referenced by BSURFS cards
+	//nodes input in local coordinate systems and their coordinate system ids, see transformLcsNodes:
+	vector <SRindex> lcsNodes;
+	vector <int> lcsNodeCoords;
 };
 
 #endif // !defined(SRINPUT_INCLUDED)
@@ -24,6 +24,13 @@ also available at <https://www.gnu.org/licenses/>
 
 #include "SRstring.h"
 #include "SRmodel.h"
+#ifdef linux
+#include <sys/mman.h>
+#include <fcntl.h>
+#else
+#include <windows.h>
+#include <intrin.h>
+#endif
 
 #ifdef _DEBUG
 #undef THIS_FILE
@@ -129,5 +136,133 @@ int SRmachDep::stringNICmp(const char* str,const char* str2,int n)
 #endif
 }
 
+const char* SRmachDep::mapFile(const char* name, long long& size)
+{
+	//map a file read-only into memory
+	//input:
+		//name = file name
+	//output:
+		//size = size of file in bytes
+	//return:
+		//pointer to start of file contents, NULL if file could not be mapped or is empty
+	size = 0;
+#ifdef linux
+	int fd = open(name, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return NULL;
+	}
+	void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	//the mapping stays valid after the file is closed:
+	close(fd);
+	if (p == MAP_FAILED)
+		return NULL;
+	madvise(p, st.st_size, MADV_SEQUENTIAL);
+	size = st.st_size;
+	return (const char*) p;
+#else
+	HANDLE fh = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (fh == INVALID_HANDLE_VALUE)
+		return NULL;
+	LARGE_INTEGER fsize;
+	if (!GetFileSizeEx(fh, &fsize) || fsize.QuadPart == 0)
+	{
+		CloseHandle(fh);
+		return NULL;
+	}
+	HANDLE mh = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(fh);
+	if (mh == NULL)
+		return NULL;
+	void* p = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+	//the view keeps the mapping alive after the handle is closed:
+	CloseHandle(mh);
+	if (p == NULL)
+		return NULL;
+	size = fsize.QuadPart;
+	return (const char*) p;
+#endif
+}
+
+void SRmachDep::unmapFile(const char* p, long long size)
+{
+	//unmap a file mapped with mapFile
+	if (p == NULL)
+		return;
+#ifdef linux
+	munmap((void*) p, size);
+#else
+	UnmapViewOfFile(p);
+#endif
+}
+
+long long SRmachDep::fileTell(FILE* fptr)
+{
+	//current write position of a file, including data still in the stream buffer
+#ifdef linux
+	return (long long) ftello(fptr);
+#else
+	return _ftelli64(fptr);
+#endif
+}
 
+bool SRmachDep::filePatch(FILE* fptr, long long pos, const char* buf, int n)
+{
+	//overwrite bytes already written to a file without moving its write position
+	//input:
+		//fptr = file open for writing
+		//pos = file position of the first byte to overwrite
+		//buf, n = new bytes
+	//return:
+		//true if successful else false
+	if (fflush(fptr) != 0)
+		return false;
+#ifdef linux
+	return pwrite(fileno(fptr), buf, n, (off_t) pos) == n;
+#else
+	long long end = _ftelli64(fptr);
+	if (_fseeki64(fptr, pos, SEEK_SET) != 0)
+		return false;
+	bool ok = (fwrite(buf, 1, n, fptr) == (size_t) n);
+	_fseeki64(fptr, end, SEEK_SET);
+	return ok;
+#endif
+}
 
+bool SRmachDep::cpuHasAvx2()
+{
+	//check if the processor and operating system support AVX2 instructions
+	//return:
+		//true if AVX2 code paths can be used, false if not or not an x86 processor
+	static int hasAvx2 = -1;
+	if (hasAvx2 != -1)
+		return (hasAvx2 == 1);
+	hasAvx2 = 0;
+#ifdef linux
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		hasAvx2 = 1;
+#endif
+#elif defined(_M_X64) || defined(_M_IX86)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] >= 7)
+	{
+		__cpuid(info, 1);
+		//the os has to save the avx registers (osxsave, avx, and xgetbv ymm state):
+		bool osAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0;
+		if (osAvx && (_xgetbv(0) & 6) == 6)
+		{
+			__cpuidex(info, 7, 0);
+			if ((info[1] & (1 << 5)) != 0)
+				hasAvx2 = 1;
+		}
+	}
+#endif
+	return (hasAvx2 == 1);
+}
@@ -82,6 +82,11 @@ public:
 	static int stringICmp(const char* str,const char* str2);
 	static int stringNCmp(const char* str,const char* str2, int n);
 	static int stringNICmp(const char* str,const char* str2, int n);
+	static const char* mapFile(const char* name, long long& size);
+	static void unmapFile(const char* p, long long size);
+	static long long fileTell(FILE* fptr);
+	static bool filePatch(FILE* fptr, long long pos, const char* buf, int n);
+	static bool cpuHasAvx2();
 };
 
 
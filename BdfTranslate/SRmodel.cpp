@@ -46,6 +46,11 @@ SRmodel::SRmodel()
 	numactiveMat = 0;
 	cropModelWithDispNodes = false;
 	partialDispFile = false;
+	renumberOutput = false;
+	useBdfIndex = false;
+	continueOnCardError = false;
+	logLevel = logInfo;
+	mergeTol = 0.0;
 	anyGeneralUnsupportedNode = false;
 	anyShellOrBeamNode = false;
 	isNx = false;
@@ -102,13 +107,19 @@ void SRmodel::CleanUp(bool partial)
 	Coords.Free();
 	materials.Free();
 	forces.Free();
-	for (int e = 0; e < GetNumElements(); e++)
+	for (SRindex e = 0; e < GetNumElements(); e++)
 	{
 		SRelement *elem = GetElement(e);
 		elem->Cleanup();
 	}
 	elements.Free();
 	volumeForces.Free();
+	nodeElemStart.Free();
+	nodeElems.Free();
+	subcases.Free();
+	loadCombinations.Free();
+	spcCombinations.Free();
+	temps.Free();
 	if (thermalForce != NULL)
 	{
 		DELETEMEMORY thermalForce;
@@ -196,6 +207,27 @@ void SRmodel::mapSetup()
 		wedgeFaceLocalEdgeMidnodeNum[3][i] = wedgefacelejtmp3[i];
 		wedgeFaceLocalEdgeMidnodeNum[4][i] = wedgefacelejtmp4[i];
 	}
+
+	//corner node masks of local faces, for constant-time face lookup:
+	for (int lf = 0; lf < 6; lf++)
+	{
+		brickFaceCornerMask[lf] = 0;
+		for (int i = 0; i < 4; i++)
+			brickFaceCornerMask[lf] |= (1u << brickFaceLocalNodes[lf][i]);
+	}
+	for (int lf = 0; lf < 4; lf++)
+	{
+		tetFaceCornerMask[lf] = 0;
+		for (int i = 0; i < 3; i++)
+			tetFaceCornerMask[lf] |= (1u << tetFaceLocalNodes[lf][i]);
+	}
+	for (int lf = 0; lf < 5; lf++)
+	{
+		int nc = (lf < 2) ? 3 : 4;
+		wedgeFaceCornerMask[lf] = 0;
+		for (int i = 0; i < nc; i++)
+			wedgeFaceCornerMask[lf] |= (1u << wedgeFaceLocalNodes[lf][i]);
+	}
 }
 
 int SRmodel::GetElementLocalFacesLocalEdgeMidNodeNum(int lface, int lej, SRelementType type)
@@ -210,6 +242,89 @@ int SRmodel::GetElementLocalFacesLocalEdgeMidNodeNum(int lface, int lej, SReleme
 		return -1;
 }
 
+unsigned SRmodel::GetElementLocalFaceCornerMask(int lface, SRelementType type)
+{
+	//mask of the local corner nodes of an element that are on a local face
+	if (type == brick)
+		return brickFaceCornerMask[lface];
+	else if (type == tet)
+		return tetFaceCornerMask[lface];
+	else if (type == wedge)
+		return wedgeFaceCornerMask[lface];
+	else
+		return 0;
+}
+
+int SRmodel::GetElementLocalFaceFirstNode(int lface, SRelementType type)
+{
+	//local node number of the first corner of a local face of an element
+	if (type == brick)
+		return brickFaceLocalNodes[lface][0];
+	else if (type == tet)
+		return tetFaceLocalNodes[lface][0];
+	else if (type == wedge)
+		return wedgeFaceLocalNodes[lface][0];
+	else
+		return -1;
+}
+
+void SRmodel::FindElemsAdjacentToBreakout()
+{
+	//find the elements that share a node with an element saved for breakout but are not saved themselves
+	//output:
+		//breakoutElems, numbreakoutElems = element numbers of the adjacent elements, in ascending order
+	//note:
+		//the node to element adjacency has to be built, see SRinput::SetNodeElmentOwners
+
+	SRindex nelem = GetNumElements();
+	vector <char> adjacent(nelem, 0);
+	for (SRindex e = 0; e < nelem; e++)
+	{
+		SRelement* elem = GetElement(e);
+		if (!elem->saveForBreakout)
+			continue;
+		for (int i = 0; i < elem->GetNumNodes(); i++)
+		{
+			SRindex nid = input.NodeFind(elem->nodeUIds.Get(i));
+			if (nid == -1)
+				continue;
+			for (SRindex j = 0; j < GetNumNodeElements(nid); j++)
+				adjacent[GetNodeElement(nid, j)] = 1;
+		}
+	}
+	breakoutElems.Free();
+	numbreakoutElems = 0;
+	for (SRindex e = 0; e < nelem; e++)
+	{
+		if (adjacent[e] && !GetElement(e)->saveForBreakout)
+			numbreakoutElems++;
+	}
+	breakoutElems.Allocate(numbreakoutElems);
+	int k = 0;
+	for (SRindex e = 0; e < nelem; e++)
+	{
+		if (adjacent[e] && !GetElement(e)->saveForBreakout)
+			breakoutElems.Put(k++, (int) e);
+	}
+}
+
+void SRmodel::PackNodeElements()
+{
+	//remove the rows of freed nodes from the node to element adjacency, to match the nodes after packNulls
+	//note:
+		//has to be called after the nodes are freed and before they are packed. freed nodes have to be
+		//orphans, so their rows are empty and nodeElems does not change
+
+	SRindex nnode = GetNumNodes();
+	SRindex k = 0;
+	for (SRindex n = 0; n < nnode; n++)
+	{
+		if (nodes.GetPointer(n) != NULL)
+			nodeElemStart.Put(++k, nodeElemStart.Get(n + 1));
+	}
+	nodeElemStart.Allocate(k + 1);
+}
+
 void SRmodel::SetBB()
 {
 	double x, y, z, xmin, xmax, ymin, ymax, zmin, zmax;
@@ -220,7 +335,7 @@ void SRmodel::SetBB()
 	ymax = -BIG;
 	zmin = BIG;
 	zmax = -BIG;
-	for (int n = 0; n < GetNumNodes(); n++)
+	for (SRindex n = 0; n < GetNumNodes(); n++)
 	{
 		SRnode *node = GetNode(n);
 		x = node->pos.d[0];
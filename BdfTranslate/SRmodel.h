@@ -24,10 +24,6 @@ also available at <https://www.gnu.org/licenses/>
 #if !defined(SRMODEL_INCLUDED)
 #define SRMODEL_INCLUDED
 
-#define MAXNMAT 100
-#define MAXNCOORD 100
-#define MAXNNODE 1000000
-#define MAXNEL 1000000
 #define MAXBREAKOUTS 100
 
 enum SRstressComponent { xxComponent, yyComponent, zzComponent, xyComponent, xzComponent, yzComponent };
@@ -49,6 +45,21 @@ enum SRstressComponent { xxComponent, yyComponent, zzComponent, xyComponent, xzC
 
 #define ERROREXIT SRmodel::ErrorExit(__FILE__,__LINE__)
 
+enum SRbreakoutType { noBreakout, boxBreakout, sphereBreakout, elemBreakout };
+
+class SRbreakoutRegion
+{
+	//region of the model kept by a breakout extraction, see SRinput::breakoutModel
+public:
+	SRbreakoutRegion(){ type = noBreakout; radius = 0.0; rings = 0; };
+	SRbreakoutType type;
+	SRvec3 p1; //box minimum corner or sphere center
+	SRvec3 p2; //box maximum corner
+	double radius; //sphere radius
+	vector <pair <int, int> > elemUids; //ranges of element user ids, first to last. sorted and disjoint
+	int rings; //number of rings of neighboring elements added to the region
+};
+
 class SRmodel
 {
 	friend class SRoutput;
@@ -71,32 +82,35 @@ public:
 		else
 			return node->isOrphan();
 	};
-	int GetNodeUid(int i){ return nodes.GetPointer(i)->userId; };
+	int GetNodeUid(SRindex i){ return nodes.GetPointer(i)->userId; };
+	SRindex GetNumNodeElements(SRindex n){ return nodeElemStart.Get(n + 1) - nodeElemStart.Get(n); };
+	SRindex GetNodeElement(SRindex n, SRindex i){ return nodeElems.Get(nodeElemStart.Get(n) + i); };
+	void PackNodeElements();
 
 	void SetBB();
 
-	int GetNumNodes(){ return nodes.GetNum(); };
-	SRnode* GetNode(int i){ return nodes.GetPointer(i); };
+	SRindex GetNumNodes(){ return nodes.GetNum(); };
+	SRnode* GetNode(SRindex i){ return nodes.GetPointer(i); };
 	SRnode* GetNodeFromUid(int i)
 	{
-		int nid = input.NodeFind(i);
+		SRindex nid = input.NodeFind(i);
 		if (nid < 0)
 			return NULL;
 		else
 			return nodes.GetPointer(nid);
 	};
 
-	int GetNumElements() { return elements.GetNum(); };
-	SRelement* GetElement(int i){ return elements.GetPointer(i); };
+	SRindex GetNumElements() { return elements.GetNum(); };
+	SRelement* GetElement(SRindex i){ return elements.GetPointer(i); };
 
 	int GetNumMaterials() { return materials.GetNum(); };
 	SRmaterial* GetMaterial(int i){ return materials.GetPointer(i); };
 
-	int GetNumConstraints(){ return constraints.GetNum(); };
-	SRconstraint* GetConstraint(int i){ return constraints.GetPointer(i); };
+	SRindex GetNumConstraints(){ return constraints.GetNum(); };
+	SRconstraint* GetConstraint(SRindex i){ return constraints.GetPointer(i); };
 
-	int GetNumForces(){ return forces.GetNum(); };
-	SRforce* GetForce(int i){ return forces.GetPointer(i); };
+	SRindex GetNumForces(){ return forces.GetNum(); };
+	SRforce* GetForce(SRindex i){ return forces.GetPointer(i); };
 
 	SRcoord* GetCoord(int i){ return Coords.GetPointer(i); };
 
@@ -104,10 +118,13 @@ public:
 
 	void mapSetup();
 	int GetElementLocalFacesLocalEdgeMidNodeNum(int lface, int lej, SRelementType type);
+	unsigned GetElementLocalFaceCornerMask(int lface, SRelementType type);
+	int GetElementLocalFaceFirstNode(int lface, SRelementType type);
 
 	//"read" routines for private data:
 	double GetSize(){ return size; };
 	bool IsAnyEnforcedDisplacement(){ return anyEnforcedDisplacement; };
+	bool isMultiSubcase(){ return subcases.GetNum() > 1; };
 	bool isNodeToFaceBCs() { return nodeToFaceBCs; };
 	void SetNodeToFaceBCs(bool tf){ nodeToFaceBCs = tf; };
 
@@ -122,6 +139,12 @@ public:
 	int numactiveMat;
 	bool cropModelWithDispNodes;
 	bool partialDispFile;
+	bool renumberOutput; //reorder nodes and elements in the .msh file for locality, see SRoutput::Renumber
+	bool useBdfIndex; //skip the counting pass with a card index sidecar, see SRinput::readBdfIndex
+	bool continueOnCardError; //skip cards that can't be translated instead of failing, see SRinput::checkCardErrors
+	SRlogLevel logLevel; //messages below this level are not written to the log file, see SRfile::PrintLogLevel
+	double mergeTol; //nodes closer than mergeTol times the model size are merged if > 0, see SRinput::mergeCoincidentNodes
+	SRbreakoutRegion breakout; //elements kept if type is not noBreakout, see SRinput::breakoutModel
 
 	SRpointerVector <SRnode> nodes;
 	SRpointerVector <SRconstraint> constraints;
@@ -133,6 +156,15 @@ public:
 	SRpointerVector <SRforce> forces;
 	SRpointerVector <SRelement> elements;
 	SRpointerVector <SRvolumeForce> volumeForces;
+	//case control subcases and the LOAD and SPCADD cards they may select, see SRinput::readCaseControl:
+	SRvector <SRsubcase> subcases;
+	SRpointerVector <SRsetCombination> loadCombinations;
+	SRpointerVector <SRsetCombination> spcCombinations;
+	SRvector <SRnodeTemp> temps;
+	//node to element adjacency: the elements using node n are nodeElems[nodeElemStart[n]] up to
+	//nodeElems[nodeElemStart[n + 1]], in ascending order. see SRinput::SetNodeElmentOwners:
+	SRvector <SRindex> nodeElemStart;
+	SRvector <SRindex> nodeElems;
 	SRthermalForce* thermalForce;
 
 	//1 instance of each utility class:
@@ -163,6 +195,10 @@ public:
 	int tetFaceLocalEdgeMidnodeNum[4][3];
 	int brickFaceLocalEdgeMidnodeNum[6][4];
 	int wedgeFaceLocalEdgeMidnodeNum[5][4];
+	//bit i is set if local corner node i is on the local face, see SRinput::findElemFace:
+	unsigned brickFaceCornerMask[6];
+	unsigned tetFaceCornerMask[4];
+	unsigned wedgeFaceCornerMask[5];
 	bool anyGeneralUnsupportedNode;
 	bool anyShellOrBeamNode;
 	bool isNx;
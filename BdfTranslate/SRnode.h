@@ -42,20 +42,20 @@ public:
 	SRvec3& Position(){ return pos; };
 	double GetXyz(int i){ return pos.d[i]; };
 	bool isOrphan() { return (firstElementOwner == -1); };
-	int GetFirstElementOwner() { return firstElementOwner; };
+	SRindex GetFirstElementOwner() { return firstElementOwner; };
 	SRforce* GetForce();
 	SRconstraint* GetConstraint();
-	void SetConstraintId(int i){ constraintId = i; };
+	void SetConstraintId(SRindex i){ constraintId = i; };
 
 	bool unSupported;
 	bool shellOrBeamNode;
 	bool bsurf;
-	int firstElementOwner;
+	SRindex firstElementOwner;
 	int userId; //user original nodes numbers in case non-contiguous
 	SRvec3 pos;
 	SRvec3 disp;
-	int constraintId;
-	int forceId;
+	SRindex constraintId;
+	SRindex forceId;
 	bool hasTemp;
 	double Temp;
 	int dispCoordid;
@@ -25,9 +25,11 @@ also available at <https://www.gnu.org/licenses/>
 
 #include <stdlib.h>
 #include <search.h>
+#include <algorithm>
 #include "SRmodel.h"
 #include "SRmachDep.h"
 #include "SRoutput.h"
+#include "SRparallel.h"
 
 extern SRmodel model;
 
@@ -36,45 +38,271 @@ extern SRmodel model;
 static char THIS_FILE[]=__FILE__;
 #endif
 
+static void SRnodeBandwidth(vector <SRindex>& pos, vector <SRindex>& elemNodeStart, vector <SRindex>& elemNodes,
+	SRindex& bandwidth, SRindex& profile);
+static SRindex SRnodeLevels(SRindex root, vector <SRindex>& elemNodeStart, vector <SRindex>& elemNodes,
+	vector <int>& visit, int& stamp, vector <SRindex>& queue);
+static unsigned long long SRmortonKey(double x, double y, double z);
+
 void SRoutput::DoOutput()
 {
+	//write the .msh file in one pass. the entity counts in the header are reserved as fixed width fields
+	//and patched once their sections are written, see ReserveCount, so the counts are the numbers of
+	//entities actually written. elements are released as they are written
 	for (int i = 0; i < model.GetNumMaterials(); i++)
 	{
 		if (model.GetMaterial(i)->active)
 			model.numactiveMat++;
 	}
+	//the .msh file has the loads and constraints of the first subcase if there are more than one.
+	//all subcases are also written to their own .loads files, see OutputSubcases
+	if (model.isMultiSubcase())
+		SelectSubcase(model.subcases.GetPointer(0));
+	//the node to element adjacency is not needed once the output order is set:
+	model.nodeElemStart.Free();
+	model.nodeElems.Free();
 	model.mshFile.PrintLine("EntityCounts From BDF translate");
-	model.mshFile.PrintLine("%d //nodes", model.GetNumNodes());
-	model.mshFile.PrintLine("%d //elements", model.GetNumElements());
+	long long nodePos = ReserveCount("nodes");
+	long long elemPos = ReserveCount("elements");
 	model.mshFile.PrintLine("%d //materials", model.numactiveMat);
-	model.mshFile.PrintLine("%d //coordinates", model.Coords.GetNum());
-	model.mshFile.PrintLine("%d //nodal contraints", model.GetNumConstraints());
+	model.mshFile.PrintLine(SRINDEXFMT " //coordinates", model.Coords.GetNum());
+	long long conPos = ReserveCount("nodal contraints");
 	model.mshFile.PrintLine("0 0 //multi face constraint groups, multi face constraints");
 	model.mshFile.PrintLine("0 //breakout constraints");
 	model.mshFile.PrintLine("0 //nodal breakout constraints");
-	model.mshFile.PrintLine("%d //forces", model.GetNumForces());
+	long long forcePos = ReserveCount("forces");
 	model.mshFile.PrintLine("0 0 //multi face force groups, multi face forces");
-	model.mshFile.PrintLine("%d //volume forces", model.volumeForces.GetNum());
-	model.mshFile.PrintLine("%d //nodesWithDisplacements", model.volumeForces.GetNum());
+	long long volPos = ReserveCount("volume forces");
+	long long dispPos = ReserveCount("nodesWithDisplacements");
 	OutputMaterials();
 	OutputCoordinates();
-	OutputNodes();
-	OutputElements();
-	OutputConstraints();
-	OutputForces();
-	OutputVolumeForces();
+	numNodesOut = OutputNodes();
+	numElemsOut = OutputElements();
+	numConstraintsOut = OutputConstraints();
+	numForcesOut = OutputForces();
+	numVolumeForcesOut = OutputVolumeForces();
 	OutputThermalForce();
+	PatchCount(nodePos, numNodesOut);
+	PatchCount(elemPos, numElemsOut);
+	PatchCount(conPos, numConstraintsOut);
+	PatchCount(forcePos, numForcesOut);
+	PatchCount(volPos, numVolumeForcesOut);
+	PatchCount(dispPos, numVolumeForcesOut);
 	model.mshFile.Close();
+	if (model.isMultiSubcase())
+		OutputSubcases();
+}
+
+long long SRoutput::ReserveCount(const char* label)
+{
+	//write a header line of the .msh file with a zero count field, to be filled in by PatchCount
+	//input:
+		//label = entity name after the count
+	//return:
+		//file position of the count field
+	long long pos = model.mshFile.Tell();
+	model.mshFile.PrintLine("%0*d //%s", COUNTFIELDWIDTH, 0, label);
+	return pos;
+}
+
+void SRoutput::PatchCount(long long pos, SRindex n)
+{
+	//fill in a count field reserved by ReserveCount
+	//input:
+		//pos = file position of the count field
+		//n = count
+	char buf[32];
+	int len = SPRINTF(buf, "%0*lld", COUNTFIELDWIDTH, (long long) n);
+	if (len != COUNTFIELDWIDTH)
+		ERROREXIT;
+	if (!model.mshFile.Patch(pos, buf, COUNTFIELDWIDTH))
+		ERROREXIT;
+}
+
+void SRoutput::OutputSubcases()
+{
+	//write the constraints and loads of each subcase to outdir/SrFileNameTail_subcase<id>.loads,
+	//in the same format as their sections of the .msh file. the loads of the sets selected by a LOAD
+	//card are scaled by its factors
+	SRstring mshName = model.mshFile.filename;
+	for (SRindex i = 0; i < model.subcases.GetNum(); i++)
+	{
+		SRsubcase* sc = model.subcases.GetPointer(i);
+		SelectSubcase(sc);
+		if (model.thermalForce != NULL && sc->tempSet == -1 && !allTemps)
+			LOGPRINTLEVEL(logWarning, " subcase %d selects no TEMP set, temperatures not applied", sc->id);
+		SRstring name;
+		SubcaseFileName(sc, name);
+		model.mshFile.SetFileName(name);
+		model.mshFile.Delete();
+		model.mshFile.Open(SRoutputMode);
+		model.mshFile.PrintLine("Subcase %d From BDF translate", sc->id);
+		long long conPos = ReserveCount("nodal contraints");
+		long long forcePos = ReserveCount("forces");
+		long long volPos = ReserveCount("volume forces");
+		SRindex ncon = OutputConstraints();
+		SRindex nforce = OutputForces();
+		SRindex nvol = OutputVolumeForces();
+		OutputThermalForce();
+		PatchCount(conPos, ncon);
+		PatchCount(forcePos, nforce);
+		PatchCount(volPos, nvol);
+		model.mshFile.Close();
+		LOGPRINT(" subcase %d: " SRINDEXFMT " constraints, " SRINDEXFMT " forces, " SRINDEXFMT " volume forces written to %s",
+			sc->id, ncon, nforce, nvol, name.getStr());
+	}
+	model.mshFile.SetFileName(mshName);
+	SelectSubcase(NULL);
+}
+
+void SRoutput::SubcaseFileName(SRsubcase* sc, SRstring& name)
+{
+	//name of the .loads file of a subcase
+	//input:
+		//sc = subcase
+	//output:
+		//name = outdir/SrFileNameTail_subcase<id>.loads
+	name = model.outdir;
+	name += slashStr;
+	name += model.SrFileNameTail;
+	char buf[32];
+	SPRINTF(buf, "_subcase%d.loads", sc->id);
+	name += buf;
 }
 
-void SRoutput::OutputNodes()
+void SRoutput::SelectSubcase(SRsubcase* sc)
 {
+	//select the loads and constraints of a subcase for output
+	//input:
+		//sc = subcase, NULL for all loads and constraints
+	//output:
+		//subcase = sc
+		//loadFactors = scale factor of each load set selected by sc, directly or through a LOAD card
+		//spcSets = constraint sets selected by sc, directly or through an SPCADD card
+		//nodeEnfds = enforced displacements of the SPCD cards in the load sets, for each node
+		//node temperatures = the TEMP set selected by sc. if no subcase selects a TEMP set, every TEMP
+		//                    card is applied, as for a model with one subcase
+	subcase = sc;
+	allTemps = false;
+	loadFactors.clear();
+	spcSets.clear();
+	nodeEnfds.clear();
+	if (sc == NULL)
+		return;
+
+	if (sc->loadSet != -1)
+	{
+		SRsetCombination* comb = NULL;
+		for (SRindex i = 0; i < model.loadCombinations.GetNum(); i++)
+		{
+			if (model.loadCombinations.GetPointer(i)->sid == sc->loadSet)
+				comb = model.loadCombinations.GetPointer(i);
+		}
+		if (comb == NULL)
+			loadFactors[sc->loadSet] = 1.0;
+		else
+		{
+			for (int i = 0; i < (int) comb->sets.size(); i++)
+				loadFactors[comb->sets[i]] += comb->scale * comb->scales[i];
+		}
+	}
+	if (sc->spcSet != -1)
+	{
+		SRsetCombination* comb = NULL;
+		for (SRindex i = 0; i < model.spcCombinations.GetNum(); i++)
+		{
+			if (model.spcCombinations.GetPointer(i)->sid == sc->spcSet)
+				comb = model.spcCombinations.GetPointer(i);
+		}
+		if (comb == NULL)
+			spcSets.insert(sc->spcSet);
+		else
+			spcSets.insert(comb->sets.begin(), comb->sets.end());
+	}
+
+	//SPCD values go to the active constraints of their node, see OutputConstraints:
+	for (SRindex e = 0; e < model.enfds.GetNum(); e++)
+	{
+		SRenfd* enfd = model.enfds.GetPointer(e);
+		double factor = LoadFactor(enfd->setId);
+		if (factor == 0.0)
+			continue;
+		if (nodeEnfds.find(enfd->nuid) == nodeEnfds.end())
+		{
+			SRconEnfd& ce = nodeEnfds[enfd->nuid];
+			for (int dof = 0; dof < 3; dof++)
+				ce.dof[dof] = false;
+		}
+		SRconEnfd& ce = nodeEnfds[enfd->nuid];
+		for (int dof = 0; dof < 3; dof++)
+		{
+			if (enfd->condof[dof])
+			{
+				ce.dof[dof] = true;
+				ce.val[dof] = factor * enfd->enfdVal;
+			}
+		}
+	}
+
+	if (model.thermalForce == NULL)
+		return;
+	allTemps = true;
+	for (SRindex i = 0; i < model.subcases.GetNum(); i++)
+	{
+		if (model.subcases.GetPointer(i)->tempSet != -1)
+			allTemps = false;
+	}
+	for (SRindex n = 0; n < model.GetNumNodes(); n++)
+		model.GetNode(n)->hasTemp = false;
+	for (SRindex t = 0; t < model.temps.GetNum(); t++)
+	{
+		SRnodeTemp* temp = model.temps.GetPointer(t);
+		if (!allTemps && temp->setId != sc->tempSet)
+			continue;
+		SRindex nid = model.input.NodeFind(temp->nodeUid);
+		if (nid == -1)
+			continue; //node may have been cropped or merged
+		SRnode* node = model.GetNode(nid);
+		node->hasTemp = true;
+		node->Temp = temp->T;
+	}
+}
+
+double SRoutput::LoadFactor(int setId)
+{
+	//scale factor of a load set in the selected subcase
+	//return:
+		//factor, 0 if the set is not in the subcase. 1 if no subcase is selected
+	if (subcase == NULL)
+		return 1.0;
+	map <int, double>::iterator it = loadFactors.find(setId);
+	if (it == loadFactors.end())
+		return 0.0;
+	return it->second;
+}
+
+bool SRoutput::ConstraintActive(SRconstraint* con)
+{
+	//check if a constraint is in the selected subcase. constraints from GRID cards are in all subcases
+	if (subcase == NULL || con->setId == -1)
+		return true;
+	return spcSets.find(con->setId) != spcSets.end();
+}
+
+SRindex SRoutput::OutputNodes()
+{
+	//return:
+		//number of nodes written
 	model.mshFile.PrintLine("nodes");
-	for (int i = 0; i < model.nodes.GetNum(); i++)
+	SRindex nout = 0;
+	SRindex num = nodeOrder.isEmpty() ? model.nodes.GetNum() : nodeOrder.GetNum();
+	for (SRindex k = 0; k < num; k++)
 	{
+		SRindex i = nodeOrder.isEmpty() ? k : nodeOrder.Get(k);
 		SRnode* node = model.GetNode(i);
 		if (node->isOrphan())
 			continue;
+		nout++;
 		if (node->unSupported)
 			model.mshFile.PrintLine(" %d %lg %lg %lg unsupported", node->GetUserid(), node->pos.d[0], node->pos.d[1], node->pos.d[2]);
 		else if (node->shellOrBeamNode)
@@ -85,75 +313,158 @@ void SRoutput::OutputNodes()
 			model.mshFile.PrintLine(" %d %lg %lg %lg", node->GetUserid(), node->pos.d[0], node->pos.d[1], node->pos.d[2]);
 	}
 	model.mshFile.PrintLine("end nodes");
-
+	return nout;
 }
-void SRoutput::OutputElements()
+
+SRindex SRoutput::OutputElements()
 {
+	//each element is released once it is written. nothing after the element section needs them
+	//return:
+		//number of elements written
 	model.mshFile.PrintLine("elements");
-	for (int i = 0; i <model.elements.GetNum(); i++)
+	SRindex nout = model.elements.GetNum();
+	for (SRindex k = 0; k < nout; k++)
 	{
+		SRindex i = elemOrder.isEmpty() ? k : elemOrder.Get(k);
 		SRelement* elem = model.GetElement(i);
 		model.mshFile.Print(" %d %s ", elem->GetUserid(), elem->matname.getStr());
 		for (int n = 0; n < elem->GetNumNodes(); n++)
-		{
-			int id = elem->GetNodeId(n);
-			int uid = model.GetNodeUid(id);
-			model.mshFile.Print(" %d", uid);
-		}
+			model.mshFile.Print(" %d", elem->nodeUIds.Get(n));
 		model.mshFile.Print("\n");
+		model.elements.Free(i);
 	}
+	model.elements.Free();
+	elemOrder.Free();
 	model.mshFile.PrintLine("end elements");
-
+	return nout;
 }
 
 
-void SRoutput::OutputConstraints()
+SRindex SRoutput::OutputConstraints()
 {
-	int n = model.constraints.GetNum();
+	//return:
+		//number of constraints written
+	//note:
+		//for a subcase, the active constraints of a node in the same coordinate system are written as one
+		//record, with the SPCD values of the subcase on its enforced dofs
+	SRindex n = model.constraints.GetNum();
 	if (n == 0)
-		return;
+		return 0;
 	model.mshFile.PrintLine("constraints");
-	for (int i = 0; i < n; i++)
+	if (subcase == NULL)
+	{
+		for (SRindex i = 0; i < n; i++)
+		{
+			SRconstraint* con = model.GetConstraint(i);
+			SRconRecord rec;
+			rec.nuid = con->entityId;
+			rec.coordId = con->coordId;
+			for (int dof = 0; dof < 3; dof++)
+			{
+				rec.disp.dof[dof] = con->IsConstrainedDof(dof);
+				rec.disp.val[dof] = rec.disp.dof[dof] ? con->getDisp(0, dof) : 0.0;
+			}
+			printConstraint(rec);
+		}
+		model.mshFile.PrintLine("end constraints");
+		return n;
+	}
+
+	vector <SRconRecord> recs;
+	map <pair <int, int>, size_t> recOf; //record of each node and coordinate system
+	for (SRindex i = 0; i < n; i++)
 	{
 		SRconstraint* con = model.GetConstraint(i);
-		int nuid = con->entityId;
-		model.mshFile.Print(" %d", nuid);
+		if (!ConstraintActive(con))
+			continue;
+		pair <int, int> key(con->entityId, con->coordId);
+		map <pair <int, int>, size_t>::iterator it = recOf.find(key);
+		if (it == recOf.end())
+		{
+			it = recOf.insert(make_pair(key, recs.size())).first;
+			SRconRecord rec;
+			rec.nuid = con->entityId;
+			rec.coordId = con->coordId;
+			for (int dof = 0; dof < 3; dof++)
+			{
+				rec.disp.dof[dof] = false;
+				rec.disp.val[dof] = 0.0;
+			}
+			recs.push_back(rec);
+		}
+		SRconRecord& rec = recs[it->second];
 		for (int dof = 0; dof < 3; dof++)
 		{
 			if (con->IsConstrainedDof(dof))
-				model.mshFile.Print(" %lg", con->getDisp(0, dof));
-			else
-				model.mshFile.Print(" -");
+			{
+				rec.disp.dof[dof] = true;
+				rec.disp.val[dof] = con->getDisp(0, dof);
+			}
 		}
-		if (con->coordId != -1)
+	}
+	for (size_t r = 0; r < recs.size(); r++)
+	{
+		SRconRecord& rec = recs[r];
+		map <int, SRconEnfd>::iterator enfd = nodeEnfds.find(rec.nuid);
+		if (enfd != nodeEnfds.end())
 		{
-			SRcoord* coord = model.GetCoord(con->coordId);
-			model.mshFile.Print(" coord %s", coord->name.getStr());
+			//constraint may be fixed in more dofs than are enforced; an SPCD on an unconstrained dof is ignored:
+			for (int dof = 0; dof < 3; dof++)
+			{
+				if (rec.disp.dof[dof] && enfd->second.dof[dof])
+					rec.disp.val[dof] = enfd->second.val[dof];
+			}
 		}
-
-		model.mshFile.Print("\n");
+		printConstraint(rec);
 	}
 	model.mshFile.PrintLine("end constraints");
+	return (SRindex) recs.size();
+}
+
+void SRoutput::printConstraint(SRconRecord& rec)
+{
+	//write a constraint record of the constraints section
+	model.mshFile.Print(" %d", rec.nuid);
+	for (int dof = 0; dof < 3; dof++)
+	{
+		if (rec.disp.dof[dof])
+			model.mshFile.Print(" %lg", rec.disp.val[dof]);
+		else
+			model.mshFile.Print(" -");
+	}
+	if (rec.coordId != -1)
+	{
+		SRcoord* coord = model.GetCoord(rec.coordId);
+		model.mshFile.Print(" coord %s", coord->name.getStr());
+	}
+	model.mshFile.Print("\n");
 }
 
 
-void SRoutput::OutputForces()
+SRindex SRoutput::OutputForces()
 {
-	int n = model.forces.GetNum();
+	//return:
+		//number of nodal forces and face pressures and tractions written
+	SRindex n = model.forces.GetNum();
 	if (n == 0)
-		return;
+		return 0;
 
+	SRindex nout = 0;
 	model.mshFile.PrintLine("forces");
 	bool anyfaceForce = false;
-	for (int i = 0; i < n; i++)
+	for (SRindex i = 0; i < n; i++)
 	{
 		SRforce* force = model.GetForce(i);
+		double factor = LoadFactor(force->setId);
+		if (factor == 0.0)
+			continue;
 		if (force->type == nodalForce)
 		{
+			nout++;
 			int nuid = force->entityId;
 			model.mshFile.Print(" %d", nuid);
 			if (force->pressure)
-				model.mshFile.PrintLine(" pressure %lg", force->GetForceVal(0, 0));
+				model.mshFile.PrintLine(" pressure %lg", factor * force->GetForceVal(0, 0));
 			else
 			{
 				if (force->coordId > 0)
@@ -165,7 +476,7 @@ void SRoutput::OutputForces()
 				else
 					model.mshFile.Print(" gcs");
 				for (int dof = 0; dof < 3; dof++)
-					model.mshFile.Print(" %lg", force->GetForceVal(0, dof));
+					model.mshFile.Print(" %lg", factor * force->GetForceVal(0, dof));
 				model.mshFile.Print("\n");
 			}
 		}
@@ -174,12 +485,13 @@ void SRoutput::OutputForces()
 	}
 	model.mshFile.PrintLine("end forces");
 	if (!anyfaceForce)
-		return;
+		return nout;
 	model.mshFile.PrintLine("facePressures");
-	for (int i = 0; i < n; i++)
+	for (SRindex i = 0; i < n; i++)
 	{
 		SRforce* force = model.GetForce(i);
-		if (force->type == faceForce)
+		double factor = LoadFactor(force->setId);
+		if (factor != 0.0 && force->type == faceForce)
 		{
 			if (force->pressure)
 			{
@@ -188,6 +500,7 @@ void SRoutput::OutputForces()
 				//n1, n2, n3, n4 = nodes at corner of face, n4 = 1 for tri
 				//p1, p2, p3, p4 = pressures at corner of face, p4 omitted for tri face
 				//p2, p3, p4 omitted for constant pressure
+				nout++;
 				int euid = force->entityId;
 				model.mshFile.Print(" %d", euid);
 				for (int n = 0; n < 4; n++)
@@ -196,17 +509,18 @@ void SRoutput::OutputForces()
 				if (force->nv[3] != -1)
 					nn = 4;
 				for (int n = 0; n < nn; n++)
-					model.mshFile.Print(" %lg", force->forceVals.Get(n, 0));
+					model.mshFile.Print(" %lg", factor * force->forceVals.Get(n, 0));
 				model.mshFile.Print("\n");
 			}
 		}
 	}
 	model.mshFile.PrintLine("end facePressures");
 	model.mshFile.PrintLine("faceTractions");
-	for (int i = 0; i < n; i++)
+	for (SRindex i = 0; i < n; i++)
 	{
 		SRforce* force = model.GetForce(i);
-		if (force->type == faceForce)
+		double factor = LoadFactor(force->setId);
+		if (factor != 0.0 && force->type == faceForce)
 		{
 			if (!force->pressure)
 			{
@@ -216,6 +530,7 @@ void SRoutput::OutputForces()
 				//# t1, t2, t3, t4   (for dof 2)
 				//elid = element that owns the face
 				//n1, n2, n3, n4 = nodes at corner of face, n4 = 1 for tri
+				nout++;
 				int euid = force->entityId;
 				model.mshFile.Print(" %d", euid);
 				for (int n = 0; n < 4; n++)
@@ -229,39 +544,49 @@ void SRoutput::OutputForces()
 				{
 					model.mshFile.Print("#");
 					for (int n = 0; n < nn; n++)
-						model.mshFile.Print(" %lg", force->forceVals.Get(n, dof));
+						model.mshFile.Print(" %lg", factor * force->forceVals.Get(n, dof));
 					model.mshFile.Print("\n");
 				}
 			}
 		}
 	}
 	model.mshFile.PrintLine("end faceTractions");
+	return nout;
 }
 
-void SRoutput::OutputVolumeForces()
+SRindex SRoutput::OutputVolumeForces()
 {
+	//return:
+		//number of volume forces written
 	int n = model.volumeForces.GetNum();
 	if (n == 0)
-		return;
+		return 0;
 
+	SRindex nout = 0;
 	model.mshFile.PrintLine("volumeforces");
 	for (int i = 0; i < n; i++)
 	{
 		SRvolumeForce* vol = model.volumeForces.GetPointer(i);
+		double factor = LoadFactor(vol->setId);
+		if (factor == 0.0)
+			continue;
+		nout++;
 		if (vol->type == gravity)
-			model.mshFile.PrintLine("gravity %lg %lg %lg", vol->g1, vol->g2, vol->g3);
+			model.mshFile.PrintLine("gravity %lg %lg %lg", factor * vol->g1, factor * vol->g2, factor * vol->g3);
 		else
 		{
-			model.mshFile.Print("centrifugal %lg", vol->omega);
+			//the load scales with omega squared and with alpha:
+			model.mshFile.Print("centrifugal %lg", sqrt(fabs(factor)) * vol->omega);
 			for (int i = 0; i < 3; i++)
 				model.mshFile.Print(" %lg", vol->axis.d[i]);
 			for (int i = 0; i < 3; i++)
 				model.mshFile.Print(" %lg", vol->origin.d[i]);
-			model.mshFile.Print(" %lg", vol->alpha);
+			model.mshFile.Print(" %lg", factor * vol->alpha);
 			model.mshFile.Print("\n");
 		}
 	}
 	model.mshFile.PrintLine("end volumeforces");
+	return nout;
 }
 
 void SRoutput::OutputMaterials()
@@ -331,6 +656,8 @@ void SRoutput::OutputThermalForce()
 	SRthermalForce* tf = model.thermalForce;
 	if (tf == NULL)
 		return;
+	if (subcase != NULL && subcase->tempSet == -1 && !allTemps)
+		return;
 
 	model.mshFile.PrintLine("Thermal Force");
 	//catch case all nodes loaded with same temp, convert to constant
@@ -364,7 +691,7 @@ void SRoutput::OutputThermalForce()
 	else
 	{
 		model.mshFile.PrintLine("variable");
-		for (int i = 0; i < model.GetNumNodes(); i++)
+		for (SRindex i = 0; i < model.GetNumNodes(); i++)
 		{
 			SRnode* node = model.GetNode(i);
 			if (node->hasTemp)
@@ -374,3 +701,276 @@ void SRoutput::OutputThermalForce()
 	model.mshFile.PrintLine("end Thermal Force");
 }
 
+
+void SRoutput::Renumber()
+{
+	//order the nodes and elements in the .msh file so that entities near each other in the mesh are
+	//near each other in the file: reverse Cuthill-McKee on the node graph for nodes, Morton order of
+	//the centroids for elements. user ids do not change. node bandwidth and profile before and after
+	//are written to the log
+	//output:
+		//nodeOrder, elemOrder = node and element numbers in output order. orphan nodes are left out
+	//note:
+		//the node to element adjacency has to be built, see SRinput::SetNodeElmentOwners
+
+	SRindex nnode = model.GetNumNodes();
+	SRindex nelem = model.GetNumElements();
+	if (nnode == 0 || nelem == 0)
+		return;
+
+	//node numbers of the elements, -1 for nodes not in the model:
+	vector <SRindex> elemNodeStart(nelem + 1);
+	elemNodeStart[0] = 0;
+	for (SRindex e = 0; e < nelem; e++)
+		elemNodeStart[e + 1] = elemNodeStart[e] + model.GetElement(e)->GetNumNodes();
+	vector <SRindex> elemNodes(elemNodeStart[nelem]);
+	SRparallel::For(nelem, FINISHCHUNKSIZE, [&](int c, long long begin, long long end)
+	{
+		for (SRindex e = begin; e < end; e++)
+		{
+			SRelement* elem = model.GetElement(e);
+			for (int i = 0; i < elem->GetNumNodes(); i++)
+				elemNodes[elemNodeStart[e] + i] = model.input.NodeLookup(elem->nodeUIds.Get(i));
+		}
+	});
+
+	//positions in the file in input order:
+	vector <SRindex> pos(nnode, -1);
+	SRindex nout = 0;
+	for (SRindex n = 0; n < nnode; n++)
+	{
+		if (!model.GetNode(n)->isOrphan())
+			pos[n] = nout++;
+	}
+	SRindex bandwidth0, profile0;
+	SRnodeBandwidth(pos, elemNodeStart, elemNodes, bandwidth0, profile0);
+
+	//Cuthill-McKee, one connected component at a time, starting each from a pseudo-peripheral node
+	//(George and Liu): the lowest degree node of the last level of a level structure, as long as that
+	//makes the level structure deeper. the element count of a node is used as its degree:
+	vector <SRindex> order;
+	order.reserve(nout);
+	vector <int> visit(nnode, 0);
+	vector <char> numbered(nnode, 0);
+	vector <SRindex> queue, nbrs;
+	int stamp = 0;
+	for (SRindex seed = 0; seed < nnode; seed++)
+	{
+		if (numbered[seed] || pos[seed] == -1)
+			continue;
+		SRindex root = seed;
+		SRindex nlevel = SRnodeLevels(root, elemNodeStart, elemNodes, visit, stamp, queue);
+		for (int iter = 0; iter < 8; iter++)
+		{
+			SRindex next = -1;
+			for (SRindex q = (SRindex) queue.size() - 1; q >= 0 && visit[queue[q]] == visit[queue.back()]; q--)
+			{
+				SRindex n = queue[q];
+				if (next == -1 || model.GetNumNodeElements(n) < model.GetNumNodeElements(next))
+					next = n;
+			}
+			SRindex nlevelNext = SRnodeLevels(next, elemNodeStart, elemNodes, visit, stamp, queue);
+			if (nlevelNext <= nlevel)
+				break;
+			root = next;
+			nlevel = nlevelNext;
+		}
+		SRindex first = order.size();
+		order.push_back(root);
+		numbered[root] = 1;
+		for (SRindex q = first; q < (SRindex) order.size(); q++)
+		{
+			SRindex n = order[q];
+			nbrs.clear();
+			for (SRindex j = 0; j < model.GetNumNodeElements(n); j++)
+			{
+				SRindex e = model.GetNodeElement(n, j);
+				for (SRindex k = elemNodeStart[e]; k < elemNodeStart[e + 1]; k++)
+				{
+					SRindex m = elemNodes[k];
+					if (m == -1 || numbered[m])
+						continue;
+					numbered[m] = 1;
+					nbrs.push_back(m);
+				}
+			}
+			stable_sort(nbrs.begin(), nbrs.end(), [](SRindex a, SRindex b)
+			{
+				return model.GetNumNodeElements(a) < model.GetNumNodeElements(b);
+			});
+			order.insert(order.end(), nbrs.begin(), nbrs.end());
+		}
+	}
+	reverse(order.begin(), order.end());
+	nodeOrder.Allocate(nout);
+	for (SRindex k = 0; k < nout; k++)
+	{
+		nodeOrder.Put(k, order[k]);
+		pos[order[k]] = k;
+	}
+	SRindex bandwidth, profile;
+	SRnodeBandwidth(pos, elemNodeStart, elemNodes, bandwidth, profile);
+	LOGPRINT(" renumbered nodes: bandwidth " SRINDEXFMT " to " SRINDEXFMT ", profile " SRINDEXFMT " to " SRINDEXFMT,
+		bandwidth0, bandwidth, profile0, profile);
+	if (profile >= profile0)
+	{
+		//input order is already better, e.g. a structured mesh numbered along its grid lines:
+		nodeOrder.Free();
+		LOGPRINT(" node input order kept");
+	}
+
+	//Morton order of the element centroids, scaled to the model bounding box:
+	double xmin[3] = { BIG, BIG, BIG };
+	double xmax[3] = { -BIG, -BIG, -BIG };
+	for (SRindex n = 0; n < nnode; n++)
+	{
+		SRvec3& p = model.GetNode(n)->pos;
+		for (int i = 0; i < 3; i++)
+		{
+			xmin[i] = min(xmin[i], p.d[i]);
+			xmax[i] = max(xmax[i], p.d[i]);
+		}
+	}
+	double scale[3];
+	for (int i = 0; i < 3; i++)
+		scale[i] = (xmax[i] > xmin[i]) ? 1.0 / (xmax[i] - xmin[i]) : 0.0;
+	vector <pair <unsigned long long, SRindex> > keys(nelem);
+	SRparallel::For(nelem, FINISHCHUNKSIZE, [&](int c, long long begin, long long end)
+	{
+		for (SRindex e = begin; e < end; e++)
+		{
+			double xc[3] = { 0.0, 0.0, 0.0 };
+			int nn = 0;
+			for (SRindex k = elemNodeStart[e]; k < elemNodeStart[e + 1]; k++)
+			{
+				if (elemNodes[k] == -1)
+					continue;
+				SRvec3& p = model.GetNode(elemNodes[k])->pos;
+				for (int i = 0; i < 3; i++)
+					xc[i] += p.d[i];
+				nn++;
+			}
+			for (int i = 0; i < 3; i++)
+				xc[i] = (nn > 0) ? (xc[i] / nn - xmin[i]) * scale[i] : 0.0;
+			keys[e] = make_pair(SRmortonKey(xc[0], xc[1], xc[2]), e);
+		}
+	});
+	sort(keys.begin(), keys.end());
+	elemOrder.Allocate(nelem);
+	for (SRindex k = 0; k < nelem; k++)
+		elemOrder.Put(k, keys[k].second);
+}
+
+static void SRnodeBandwidth(vector <SRindex>& pos, vector <SRindex>& elemNodeStart, vector <SRindex>& elemNodes,
+	SRindex& bandwidth, SRindex& profile)
+{
+	//bandwidth and profile of the node graph for a node order. nodes are neighbors if they share an element
+	//input:
+		//pos = position of each node in the order, -1 for nodes not in it
+		//elemNodeStart, elemNodes = node numbers of each element
+	//output:
+		//bandwidth = largest distance in the order between neighbors
+		//profile = sum over the nodes of the distance to the earliest neighbor
+
+	SRindex nnode = pos.size();
+	SRindex nelem = elemNodeStart.size() - 1;
+	vector <SRindex> first(pos);
+	bandwidth = 0;
+	for (SRindex e = 0; e < nelem; e++)
+	{
+		SRindex emin = -1, emax = -1;
+		for (SRindex k = elemNodeStart[e]; k < elemNodeStart[e + 1]; k++)
+		{
+			if (elemNodes[k] == -1)
+				continue;
+			SRindex p = pos[elemNodes[k]];
+			if (emin == -1 || p < emin)
+				emin = p;
+			if (p > emax)
+				emax = p;
+		}
+		if (emin == -1)
+			continue;
+		bandwidth = max(bandwidth, emax - emin);
+		for (SRindex k = elemNodeStart[e]; k < elemNodeStart[e + 1]; k++)
+		{
+			SRindex n = elemNodes[k];
+			if (n != -1 && emin < first[n])
+				first[n] = emin;
+		}
+	}
+	profile = 0;
+	for (SRindex n = 0; n < nnode; n++)
+	{
+		if (pos[n] != -1)
+			profile += pos[n] - first[n];
+	}
+}
+
+static SRindex SRnodeLevels(SRindex root, vector <SRindex>& elemNodeStart, vector <SRindex>& elemNodes,
+	vector <int>& visit, int& stamp, vector <SRindex>& queue)
+{
+	//breadth first level structure of the node graph from root, see SRoutput::Renumber
+	//input:
+		//root = starting node
+		//elemNodeStart, elemNodes = node numbers of each element
+		//visit = visit stamps of the nodes
+		//stamp = largest stamp in visit
+	//output:
+		//visit = stamp + 1 + level of each node reached
+		//stamp = largest stamp in visit
+		//queue = nodes reached, in order of level
+	//return:
+		//number of levels
+
+	int base = stamp + 1;
+	queue.clear();
+	queue.push_back(root);
+	visit[root] = base;
+	SRindex nlevel = 1;
+	for (SRindex q = 0; q < (SRindex) queue.size(); q++)
+	{
+		SRindex n = queue[q];
+		int level = visit[n];
+		for (SRindex j = 0; j < model.GetNumNodeElements(n); j++)
+		{
+			SRindex e = model.GetNodeElement(n, j);
+			for (SRindex k = elemNodeStart[e]; k < elemNodeStart[e + 1]; k++)
+			{
+				SRindex m = elemNodes[k];
+				if (m == -1 || visit[m] >= base)
+					continue;
+				visit[m] = level + 1;
+				nlevel = level + 2 - base;
+				queue.push_back(m);
+			}
+		}
+	}
+	stamp = base + (int) nlevel - 1;
+	return nlevel;
+}
+
+static unsigned long long SRmortonKey(double x, double y, double z)
+{
+	//Morton key of a point in the unit cube: the bits of the 21 bit integer coordinates, interleaved
+	//input:
+		//x, y, z = coordinates between 0 and 1
+	//return:
+		//key
+
+	double c[3] = { x, y, z };
+	unsigned long long key = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		double t = c[i] * 2097151.0;
+		unsigned long long v = (t <= 0.0) ? 0 : (t >= 2097151.0) ? 2097151 : (unsigned long long) t;
+		//spread the 21 bits 3 apart:
+		v = (v | (v << 32)) & 0x1f00000000ffffULL;
+		v = (v | (v << 16)) & 0x1f0000ff0000ffULL;
+		v = (v | (v << 8)) & 0x100f00f00f00f00fULL;
+		v = (v | (v << 4)) & 0x10c30c30c30c30c3ULL;
+		v = (v | (v << 2)) & 0x1249249249249249ULL;
+		key |= v << i;
+	}
+	return key;
+}
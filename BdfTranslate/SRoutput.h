@@ -24,25 +24,72 @@ also available at <https://www.gnu.org/licenses/>
 #if !defined(SROUTPUT_INCLUDED)
 #define SROUTPUT_INCLUDED
 
+#include <map>
+#include <set>
 #include "SRfile.h"
 #include "SRstring.h"
 
 class SRdoubleMatrix;
 class SRintVector;
+class SRsubcase;
+class SRconstraint;
+
+struct SRconEnfd
+{
+	//enforced displacements of a node from the SPCD cards of a subcase
+	bool dof[3];
+	double val[3];
+};
+
+struct SRconRecord
+{
+	//the active constraints of a node in one coordinate system, merged for output of a subcase.
+	//see SRoutput::OutputConstraints
+	int nuid;
+	int coordId;
+	SRconEnfd disp; //constrained dofs and their displacements
+};
+
+//width of the entity count fields in the header of the .msh file, see SRoutput::ReserveCount.
+//counts are zero-padded so each header line is still a single number followed by "//label":
+#define COUNTFIELDWIDTH 12
 
 class SRoutput  
 {
 public:
+	SRoutput(){ subcase = NULL; allTemps = false; numNodesOut = numElemsOut = numConstraintsOut = numForcesOut = numVolumeForcesOut = 0; };
 	void DoOutput();
-	void OutputNodes();
-	void OutputElements();
-	void OutputConstraints();
-	void OutputForces();
-	void OutputVolumeForces();
+	void OutputSubcases();
+	void SubcaseFileName(SRsubcase* sc, SRstring& name);
+	void SelectSubcase(SRsubcase* sc);
+	double LoadFactor(int setId);
+	bool ConstraintActive(SRconstraint* con);
+	long long ReserveCount(const char* label);
+	void PatchCount(long long pos, SRindex n);
+	SRindex OutputNodes();
+	SRindex OutputElements();
+	SRindex OutputConstraints();
+	void printConstraint(SRconRecord& rec);
+	SRindex OutputForces();
+	SRindex OutputVolumeForces();
 	void OutputThermalForce();
 	void OutputMaterials();
 	void OutputCoordinates();
 	void printNodalForce(int nodeUid, SRforce* force, SRfile&f);
+	void Renumber();
+	SRvector <SRindex> nodeOrder; //node numbers in output order, empty for input order. see Renumber
+	SRvector <SRindex> elemOrder; //element numbers in output order, empty for input order
+	SRsubcase* subcase; //subcase being output, NULL for all loads and constraints. see SelectSubcase
+	map <int, double> loadFactors; //scale factor of each load set in the subcase
+	set <int> spcSets; //constraint sets in the subcase
+	map <int, SRconEnfd> nodeEnfds; //SPCD values of the subcase for each node user id
+	bool allTemps; //no subcase selects a TEMP set, so every TEMP card is applied. see SelectSubcase
+	//number of entities written to the .msh file:
+	SRindex numNodesOut;
+	SRindex numElemsOut;
+	SRindex numConstraintsOut;
+	SRindex numForcesOut;
+	SRindex numVolumeForcesOut;
 	SRdoubleMatrix nodalStress;
 	SRintVector nodeCount;
 	double svmmax;
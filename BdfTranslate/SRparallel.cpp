@@ -0,0 +1,50 @@
+/*
+Copyright (c) 2020 Richard King
+
+BdfTranslate is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+BdfTranslate is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+The terms of the GNU General Public License are explained in the file COPYING.txt,
+also available at <https://www.gnu.org/licenses/>
+*/
+
+//////////////////////////////////////////////////////////////////////
+//
+// SRparallel.cpp: implementation of the SRparallel class.
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "SRparallel.h"
+
+int SRparallel::GetNumThreads()
+{
+	//number of threads to use for parallel loops
+	static int numThreads = 0;
+	if (numThreads == 0)
+	{
+		numThreads = (int) thread::hardware_concurrency();
+		if (numThreads < 1)
+			numThreads = 1;
+	}
+	return numThreads;
+}
+
+int SRparallel::GetNumChunks(long long n, long long minChunk)
+{
+	//number of chunks a range of size n will be split into by For
+	if (minChunk < 1)
+		minChunk = 1;
+	long long nchunk = n / minChunk;
+	if (nchunk > GetNumThreads())
+		nchunk = GetNumThreads();
+	if (nchunk < 1)
+		nchunk = 1;
+	return (int) nchunk;
+}
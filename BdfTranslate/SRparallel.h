@@ -0,0 +1,120 @@
+/*
+Copyright (c) 2020 Richard King
+
+BdfTranslate is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+BdfTranslate is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+The terms of the GNU General Public License are explained in the file COPYING.txt,
+also available at <https://www.gnu.org/licenses/>
+*/
+
+//////////////////////////////////////////////////////////////////////
+//
+// SRparallel.h: interface for the SRparallel class.
+// simple fork-join loops over std::thread
+//
+//////////////////////////////////////////////////////////////////////
+
+#if !defined(SRPARALLEL_INCLUDED)
+#define SRPARALLEL_INCLUDED
+
+#include <thread>
+#include <vector>
+#include <atomic>
+
+using namespace std;
+
+class SRparallel
+{
+public:
+	static int GetNumThreads();
+	static int GetNumChunks(long long n, long long minChunk);
+
+	template <class F> static void For(long long n, long long minChunk, F f)
+	{
+		//run f(chunk, begin, end) over the range 0 to n, split into contiguous chunks
+		//chunk 0 runs on the calling thread
+		//input:
+			//n = size of range
+			//minChunk = smallest range worth giving to a thread
+			//f = function to call for each chunk. chunk is 0 to GetNumChunks(n, minChunk) - 1
+		int nchunk = GetNumChunks(n, minChunk);
+		if (nchunk <= 1)
+		{
+			f(0, (long long) 0, n);
+			return;
+		}
+		vector <thread> threads;
+		long long chunkSize = n / nchunk;
+		for (int c = 1; c < nchunk; c++)
+		{
+			long long begin = c * chunkSize;
+			long long end = (c == nchunk - 1) ? n : begin + chunkSize;
+			threads.push_back(thread(f, c, begin, end));
+		}
+		f(0, (long long) 0, chunkSize);
+		for (int c = 0; c < (int) threads.size(); c++)
+			threads[c].join();
+	};
+};
+
+template <class T> class SRspscQueue
+{
+	//bounded lock-free queue between one producer thread and one consumer thread.
+	//Push waits while the queue is full and Pop while it is empty, so a stage that gets ahead is held back
+	//by the stage after it. after Abort, waiting calls return false so both threads can be shut down
+public:
+	SRspscQueue(){ head = 0; tail = 0; aborted = false; };
+	void Allocate(int capacity)
+	{
+		//capacity = most items in the queue at once. call before the threads start
+		slots.assign(capacity + 1, T());
+		head = 0;
+		tail = 0;
+		aborted = false;
+	};
+	bool Push(const T& v)
+	{
+		//producer side. return false if aborted
+		size_t t = tail.load(memory_order_relaxed);
+		size_t next = (t + 1 == slots.size()) ? 0 : t + 1;
+		while (next == head.load(memory_order_acquire))
+		{
+			if (aborted.load(memory_order_relaxed))
+				return false;
+			this_thread::yield();
+		}
+		slots[t] = v;
+		tail.store(next, memory_order_release);
+		return true;
+	};
+	bool Pop(T& v)
+	{
+		//consumer side. return false if aborted
+		size_t h = head.load(memory_order_relaxed);
+		while (h == tail.load(memory_order_acquire))
+		{
+			if (aborted.load(memory_order_relaxed))
+				return false;
+			this_thread::yield();
+		}
+		v = slots[h];
+		head.store((h + 1 == slots.size()) ? 0 : h + 1, memory_order_release);
+		return true;
+	};
+	void Abort(){ aborted.store(true, memory_order_relaxed); };
+private:
+	vector <T> slots;
+	atomic <size_t> head; //next slot to pop
+	atomic <size_t> tail; //next slot to push
+	atomic <bool> aborted;
+};
+
+#endif //!defined(SRPARALLEL_INCLUDED)
@@ -21,14 +21,19 @@ also available at <https://www.gnu.org/licenses/>
 //
 //////////////////////////////////////////////////////////////////////
 
+#include <stdlib.h>
 #include "SRmachDep.h"
 #include "SRstring.h"
-#include <sstream>  
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SRSTRING_SSE2
+#include <emmintrin.h>
+#ifndef linux
+#include <intrin.h>
+#endif
+#endif
 
 using namespace std;
 
-static char bdfBuf[18];
-
 static string strBuf;
 
 SRstring::SRstring(SRstring& s2)
@@ -45,9 +50,10 @@ SRstring::SRstring()
 {
 	fresh = true;
 	setTokSep(' ');
-	tokNum = 0;
-	bdfPointer = 0;
+	tokPos = 0;
+	bdfFieldNum = 0;
 	bdfWidth = 8;
+	bdfFormat = SRbdfSmallField;
 };
 
 
@@ -60,7 +66,7 @@ void SRstring::Clear()
 {
 	//clear a string for reuse
 	str.erase();
-	strSubs.clear();
+	tokPos = 0;
 };
 
 const char* SRstring::getStr()
@@ -86,9 +92,11 @@ void SRstring::Copy(SRstring& s2)
 	str.assign(s2.str);
 	bdfWidth = s2.bdfWidth;
 	fresh = s2.fresh;
-	tokNum = 0;
-	bdfPointer = 0;
+	tokPos = 0;
+	bdfFields.assign(s2.bdfFields.begin(), s2.bdfFields.end());
+	bdfFieldNum = 0;
 	bdfWidth = s2.bdfWidth;
+	bdfFormat = s2.bdfFormat;
 	setTokSep(s2.tokSep);
 };
 
@@ -117,14 +125,51 @@ void SRstring::Copy(const char *s, int n)
 	//input:
 		//s = string
 		//n = number of characters to copy. If n is 0, copy length of s
+	if (s != NULL && n > 0)
+	{
+		Assign(s, n);
+		return;
+	}
 	Clear();
 	if(s == NULL)
 		return;
 	fresh = true;
 	str.assign(s);
-	tokNum = 0;
-	bdfPointer = 0;
+	tokPos = 0;
+	bdfFields.clear();
+	bdfFieldNum = 0;
 	bdfWidth = 8;
+	bdfFormat = SRbdfSmallField;
+	setTokSep(' ');
+}
+
+void SRstring::Swap(SRstring& s2)
+{
+	//exchange contents with s2, including the fields of an assembled bdf card, without copying
+	str.swap(s2.str);
+	swap(tokPos, s2.tokPos);
+	swap(tokSep, s2.tokSep);
+	swap(bdfWidth, s2.bdfWidth);
+	swap(bdfFormat, s2.bdfFormat);
+	bdfFields.swap(s2.bdfFields);
+	swap(bdfFieldNum, s2.bdfFieldNum);
+	swap(fresh, s2.fresh);
+	tokBuf.swap(s2.tokBuf);
+}
+
+void SRstring::Assign(const char *s, int n)
+{
+	//Copy n characters of s, overriding SRstring.str of "this"
+	//input:
+		//s = string, does not have to be null-terminated
+		//n = number of characters to copy
+	str.assign(s, n);
+	fresh = true;
+	tokPos = 0;
+	bdfFields.clear();
+	bdfFieldNum = 0;
+	bdfWidth = 8;
+	bdfFormat = SRbdfSmallField;
 	setTokSep(' ');
 }
 
@@ -199,61 +244,132 @@ bool SRstring::Compare(const char *s2, int n)
 		return (str.compare(0, n, s2) == 0);
 }
 
-const char *SRstring::Token()
+static inline int firstMatch(unsigned mask)
 {
-if (strSubs.size() == 0)
+	//position of lowest set bit of a nonzero mask
+#ifdef linux
+	return __builtin_ctz(mask);
+#else
+	unsigned long pos;
+	_BitScanForward(&pos, mask);
+	return (int) pos;
+#endif
+}
+
+static const char* scanChar(const char* p, const char* end, char c, bool match)
+{
+	//scan for the first character that is c (match = true) or is not c (match = false)
+	//input:
+		//p, end = range to scan
+		//c = character to look for
+		//match = true to find c, false to find anything else
+	//return:
+		//location of the character found, end if none
+	//note:
+		//scans 16 characters at a time with SSE2 where available
+#ifdef SRSTRING_SSE2
+	__m128i cv = _mm_set1_epi8(c);
+	while (end - p >= 16)
 	{
-		tokNum = 0;
-		//split the string using tokSep
+		__m128i v = _mm_loadu_si128((const __m128i*) p);
+		unsigned mask = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(v, cv));
+		if (!match)
+			mask = ~mask & 0xffff;
+		if (mask != 0)
+			return p + firstMatch(mask);
+		p += 16;
+	}
+#endif
+	while (p < end)
+	{
+		if ((*p == c) == match)
+			return p;
+		p++;
+	}
+	return end;
+}
 
-		// stringstream class ss; 
-		stringstream ss(str);
+bool SRstring::TokenView(const char*& tok, int& len)
+{
+	//get the next token of this string without copying it. scans str in place starting at tokPos
+	//output:
+		//tok = start of token in str
+		//len = length of token
+	//return:
+		//false if there are no more tokens
+	//note:
+		//if tokSep is ' ', consecutive blanks are one separator and blank tokens are skipped.
+		//for other separators (csv) each separator ends a field, so empty fields are returned with len 0.
+		//tok is not null-terminated, but the token is followed by a separator or the end of str
 
-		string subfound;
-		while (getline(ss, subfound, tokSep))
+	int n = str.size();
+	if (tokPos >= n)
+		return false;
+	const char* s = str.data();
+	const char* end = s + n;
+	const char* p = s + tokPos;
+	if (tokSep == ' ')
+	{
+		p = scanChar(p, end, ' ', false);
+		if (p == end)
 		{
-			if(subfound.size() > 0)
-				strSubs.push_back(subfound);
+			tokPos = n;
+			return false;
 		}
 	}
-	if (tokNum >= (int) strSubs.size())
+	const char* e = scanChar(p, end, tokSep, true);
+	tok = p;
+	len = e - p;
+	//skip the separator:
+	tokPos = (e - s) + 1;
+	return true;
+}
+
+const char *SRstring::Token()
+{
+	//get the next token of this string, see TokenView
+	//return:
+		//the token, null-terminated. valid until the next call to Token. NULL if there are no more tokens
+	const char* tok;
+	int len;
+	if (!TokenView(tok, len))
 		return NULL;
-	else
-	{
-		const char* retChars = strSubs[tokNum].c_str();
-		tokNum++;
-		return retChars;
-	}
+	tokBuf.assign(tok, len);
+	return tokBuf.c_str();
 }
 
 bool SRstring::TokRead(int &i)
 {
 //get next Token of this string, interpret as integer
-	const char *s = Token();
+	const char* s;
+	int len;
 	i = -1;
-	if (s == NULL)
+	if (!TokenView(s, len))
 		return false;
-	if (strIsBlank(s))
-		return false;
-	if (SSCANF(s, "%d", &i) > 0)
-		return true;
-	else
+	//the token is followed by a separator or the end of str, so it can be converted in place.
+	//strtol is used instead of sscanf, which scans the whole rest of the string:
+	char* e;
+	long v = strtol(s, &e, 10);
+	if (e == s || e > s + len)
 		return false;
+	i = (int) v;
+	return true;
 }
 
 bool SRstring::TokRead(double  &r)
 {
 	//get next Token of this string, interpret as double
-	const char *s = Token();
+	const char* s;
+	int len;
 	r = 0.0;
-	if (strIsBlank(s))
+	if (!TokenView(s, len))
 		return false;
-	if (s == NULL)
-		return false;
-	if (SSCANF(s, "%lg", &r) > 0)
-		return true;
-	else
+	char* e;
+	double v = strtod(s, &e);
+	if (e == s || e > s + len)
 		return false;
+	r = v;
+	return true;
 }
 
 int SRstring::IntRead()
@@ -355,79 +471,222 @@ bool SRstring::isBdfComment(bool &isMat, SRstring& matname)
 
 }
 
+//format policies for assembling bdf cards. the format of a card is chosen once, in bdfStartCard,
+//so each field loop is compiled for its format and the field width is a constant
+
+template <int W> struct SRfixedField
+{
+	//small (W = 8) or large (W = 16) field format. see bdfAddLine
+	static void AddLine(vector <SRbdfField>& fields, const char* s, int len, bool firstLine, bool continued)
+	{
+		SRbdfField f;
+		if (len > 72)
+			len = 72;
+		if (firstLine)
+		{
+			f.s = s;
+			f.len = len < 8 ? len : 8;
+			fields.push_back(f);
+		}
+		int pos = 8;
+		for (int i = 0; i < 64 / W; i++)
+		{
+			if (pos >= len)
+			{
+				if (!continued)
+					break;
+				f.s = s;
+				f.len = 0;
+			}
+			else
+			{
+				f.s = s + pos;
+				f.len = len - pos;
+				if (f.len > W)
+					f.len = W;
+			}
+			fields.push_back(f);
+			pos += W;
+		}
+	}
+};
+
+typedef SRfixedField<8> SRsmallField;
+typedef SRfixedField<16> SRlargeField;
+
+struct SRfreeField
+{
+	//free field (csv) format. see bdfAddLine
+	static void AddLine(vector <SRbdfField>& fields, const char* s, int len, bool firstLine, bool continued)
+	{
+		SRbdfField f;
+		int nfirst = fields.size();
+		const char* p = s;
+		const char* end = s + len;
+		int i = 0;
+		while (1)
+		{
+			const char* e = (const char*) memchr(p, ',', end - p);
+			if (e == NULL)
+				e = end;
+			if (firstLine || i != 0)
+			{
+				f.s = p;
+				f.len = e - p;
+				fields.push_back(f);
+			}
+			i++;
+			if (e == end)
+				break;
+			p = e + 1;
+		}
+		if (continued && (int) fields.size() > nfirst)
+		{
+			f = fields.back();
+			bool marker = true;
+			for (int k = 0; k < f.len; k++)
+			{
+				if (f.s[k] != ' ')
+				{
+					marker = false;
+					break;
+				}
+			}
+			if (!marker && i == 10)
+				marker = (f.s[0] == '+' || f.s[0] == '*');
+			if (marker)
+				fields.pop_back();
+		}
+	}
+};
+
+bool SRstring::bdfField(const char*& s, int& len)
+{
+	//get the next field of a bdf card assembled by SRfile::GetBdfLine without copying it
+	//output:
+		//s = start of the field, not null-terminated
+		//len = length of the field, with any trailing blanks
+	//return:
+		//false at end of card
+	if (bdfFieldNum >= (int) bdfFields.size())
+		return false;
+	SRbdfField& f = bdfFields[bdfFieldNum];
+	bdfFieldNum++;
+	s = f.s;
+	len = f.len;
+	return true;
+}
+
 const char* SRstring::BdfToken(bool skipOnly)
 {
-	if (str.size() == 0)
+	//get the next field of a bdf card assembled by SRfile::GetBdfLine
+	//input:
+		//skipOnly = true to advance past the field without returning it
+	//return:
+		//the field, null-terminated. valid until the next call to BdfToken. NULL at end of card or if skipOnly
+	const char* s;
+	int len;
+	if (!bdfField(s, len))
+		return NULL;
+	if (skipOnly)
 		return NULL;
-	if (!isCsv())
+	strBuf.assign(s, len);
+	return strBuf.c_str();
+}
+
+void SRstring::bdfStartCard()
+{
+	//start assembling a bdf card whose first line is in str: decide its format. see SRfile::GetBdfLine
+	bdfFields.clear();
+	bdfFieldNum = 0;
+	bdfWidth = 8;
+	setTokSep(' ');
+	if (LastChar(',') != NULL)
 	{
-		int n = str.size() - bdfPointer;
-		if (n <= 0)
-			return NULL;
-		int width = getBdfWidth();
-		if (n > width)
-			n = width;
-		int pprev = bdfPointer;
-		bdfPointer += width;
-		if (skipOnly)
-			return NULL;
-		strBuf = str.substr(pprev, n);
-		const char* s = strBuf.c_str();
-		return s;
-	
+		setTokSep(',');
+		bdfFormat = SRbdfFreeField;
+		return;
 	}
+	bdfCheckLargeField();
+	if (bdfWidth == 16)
+		bdfFormat = SRbdfLargeField;
 	else
-	{
-		const char* s = Token();
-		if (skipOnly)
-			return NULL;
-		STRCPY(bdfBuf, 17, s);
-		return bdfBuf;
-	}
+		bdfFormat = SRbdfSmallField;
 }
 
+void SRstring::bdfAddLine(const char* s, int len, bool firstLine, bool continued)
+{
+	//add the fields of one physical line of a bdf card to bdfFields
+	//input:
+		//s = start of the line, not null-terminated
+		//len = length of the line
+		//firstLine = true if this is the first line of the card, false for continuation lines
+		//continued = true if a continuation line follows this one
+	//note:
+		//fixed format: columns 73-80 are the continuation field and are ignored.
+		//the first 8 columns are the card name on the first line, the continuation marker on others.
+		//a line that is continued contributes all of its data fields, blank if past the end of the line,
+		//so the fields of the next line stay in position. the last line stops at its end.
+		//csv: the first field of a continuation line is its marker. the last field of a continued line
+		//is dropped if it is blank or the 10th field starting with '+' or '*'
+	if (bdfFormat == SRbdfSmallField)
+		SRsmallField::AddLine(bdfFields, s, len, firstLine, continued);
+	else if (bdfFormat == SRbdfLargeField)
+		SRlargeField::AddLine(bdfFields, s, len, firstLine, continued);
+	else
+		SRfreeField::AddLine(bdfFields, s, len, firstLine, continued);
+}
 
 bool SRstring::BdfRead(int &i)
 {
+	//read the next field of a bdf card as an integer
+	//return:
+		//false if the field is blank, not an integer, or at end of card
 	i = 0;
-	const char* s = BdfToken(false);
-	if (s == NULL)
+	const char* s;
+	int len;
+	if (!bdfField(s, len))
 		return false;
-	if (strIsBlank(s))
+	if (strIsBlank(s, len))
 		return false;
-	if (SSCANF(s, "%d", &i) > 0)
-		return true;
-	else
+	//the field isn't null-terminated in the input buffer:
+	char buf[64];
+	if (len > 63)
+		len = 63;
+	memcpy(buf, s, len);
+	buf[len] = '\0';
+	char* e;
+	long v = strtol(buf, &e, 10);
+	if (e == buf)
 		return false;
+	i = (int) v;
+	return true;
 }
 
 bool SRstring::BdfRead(double &r)
 {
+	//read the next field of a bdf card as a real. Nastran exponents without an 'E' (e.g. 1.0-3) are allowed
+	//return:
+		//false if the field is blank, not a number, or at end of card
 	r = 0.0;
-	const char* s = BdfToken(false);
-	if (s == NULL)
+	const char* s;
+	int len;
+	if (!bdfField(s, len))
 		return false;
-	if (strIsBlank(s))
+	if (strIsBlank(s, len))
 		return false;
-	char buf[20];
-	realStringCopy(buf, s, strlen(s));
-	if (SSCANF(buf, "%lg", &r) > 0)
-		return true;
-	else
+	//realStringCopy may insert an 'E' before each sign, so buf needs room for 2*len + 1 characters.
+	//csv fields aren't limited to the 16 characters of a large field:
+	char buf[128];
+	if (len > 62)
+		len = 62;
+	realStringCopy(buf, s, len);
+	char* e;
+	double v = strtod(buf, &e);
+	if (e == buf)
 		return false;
-}
-
-
-bool SRstring::continueCheck()
-{
-	if (str.size() > 72)
-	{
-		char c = str[72];
-		truncate(72);
-		if (c == '+')
-			return true;
-	}
-	return false;
+	r = v;
+	return true;
 }
 
 
@@ -450,20 +709,6 @@ void SRstring::bdfCheckLargeField()
 		bdfWidth = 16;
 }
 
-int SRstring::getBdfWidth()
-{
-	if (bdfPointer > 7)
-		return bdfWidth;
-	else
-		return 8;
-}
-
-void SRstring::truncate(int n)
-{
-	//truncate this field at char n
-	str.resize(n);
-}
-
 void SRstring::TrimWhiteSpace()
 {
 	int k = 0;
@@ -481,7 +726,11 @@ void SRstring::TrimWhiteSpace()
 
 bool SRstring::strIsBlank(const char* str)
 {
-	int n = strlen(str);
+	return strIsBlank(str, strlen(str));
+}
+
+bool SRstring::strIsBlank(const char* str, int n)
+{
 	for (int i = 0; i < n; i++)
 	{
 		if (str[i] != ' ')
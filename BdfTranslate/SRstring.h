@@ -30,6 +30,15 @@ also available at <https://www.gnu.org/licenses/>
 
 using namespace std;
 
+//one field of an assembled bdf card. points into the input file buffer, see SRfile::GetBdfLine
+struct SRbdfField
+{
+	const char* s;
+	int len;
+};
+
+enum SRbdfFormat { SRbdfSmallField, SRbdfLargeField, SRbdfFreeField };
+
 
 class SRstring
 {
@@ -61,6 +70,8 @@ public:
 	void Left(int n, SRstring &s2);
 	void Right(char c, SRstring &s2);
 	void Copy(const char* s, int n = 0);
+	void Assign(const char* s, int n);
+	void Swap(SRstring& s2);
 	void Cat(const char* s);
 	void Cat(SRstring& s2);
 	bool Compare(const char* s2, int n = 0);
@@ -68,7 +79,9 @@ public:
 	bool isBlank();
 	bool isBdfComment(bool &isMat, SRstring& matname);
 	const char* Token();
+	bool TokenView(const char*& tok, int& len);
 	const char* BdfToken(bool skipOnly = true);
+	bool bdfField(const char*& s, int& len);
 	bool TokRead(int& i);
 	bool TokRead(double& r);
 	bool BdfRead(int& i);
@@ -76,23 +89,25 @@ public:
 	double RealRead();
 	int IntRead();
 	void setTokSep(const char sep);
-	bool continueCheck();
 	void TrimWhiteSpace();
 	bool strIsBlank(const char* str);
+	bool strIsBlank(const char* str, int n);
 
 	int FirstCharLocation(const char c);
 	void bdfCheckLargeField();
-	int getBdfWidth();
-	void truncate(int n);
+	void bdfStartCard();
+	void bdfAddLine(const char* s, int len, bool firstLine, bool continued);
 	int getLength();
 
 	string str;
-	int tokNum;
+	int tokPos; //position in str where the search for the next token starts
 	char tokSep;
-	int bdfPointer;
 	int bdfWidth;
+	SRbdfFormat bdfFormat; //format of the card being assembled, see bdfStartCard
+	vector <SRbdfField> bdfFields; //fields of an assembled bdf card
+	int bdfFieldNum; //next field of bdfFields returned by BdfToken
 	bool fresh;
-	vector <string> strSubs;
+	string tokBuf; //storage for the token returned by Token(), reused
 };
 
 #endif //if !defined(SRSTRING_INCLUDED)
@@ -31,7 +31,7 @@ void SRintVector::PushBack(int v)
 	tmp.Copy(*this);
 	num++;
 	Allocate(num);
-	for (int i = 0; i < tmp.GetNum(); i++)
+	for (SRindex i = 0; i < tmp.GetNum(); i++)
 		d[i] = tmp.d[i];
 	d[num - 1] = v;
 };
@@ -42,7 +42,7 @@ void SRdoubleVector::PushBack(double v)
 	tmp.Copy(*this);
 	num++;
 	Allocate(num);
-	for (int i = 0; i < tmp.GetNum(); i++)
+	for (SRindex i = 0; i < tmp.GetNum(); i++)
 		d[i] = tmp.d[i];
 	d[num - 1] = v;
 };
@@ -79,7 +79,7 @@ int SRIntCompareFunc(const void *v1, const void *v2)
 	return *((int *)v1) - *((int *)v2);
 }
 
-int SRintVector::Find(int intIn)
+SRindex SRintVector::Find(int intIn)
 {
 	//find an integer in this vector using binary search
 	//input:
@@ -25,6 +25,7 @@ also available at <https://www.gnu.org/licenses/>
 #define SRUTIL_INCLUDED
 
 #include <memory.h>
+#include <new>
 #include <vector>
 
 using namespace std;
@@ -35,6 +36,18 @@ using namespace std;
 #define ALLOCATEMEMORY new
 #define DELETEMEMORY delete
 
+//index and count type for model entities and the containers that hold them.
+//int by default so typical models don't pay for wider indices;
+//define SR_LARGE_MODEL for models with more than 2^31 - 1 nodes or elements.
+//user ids stay int, as in Nastran
+#ifdef SR_LARGE_MODEL
+typedef long long SRindex;
+#define SRINDEXFMT "%lld"
+#else
+typedef int SRindex;
+#define SRINDEXFMT "%d"
+#endif
+
 class SRutil  
 {
 
@@ -46,9 +59,9 @@ class SRintVector
 {
 public:
 	void Sort();
-	int Find(int intIn);
+	SRindex Find(int intIn);
 	bool isEmpty(){ return (d == NULL); };
-	int GetNum(){ return num; };
+	SRindex GetNum(){ return num; };
 	void Free()
 	{
 		if(num == 0)
@@ -57,7 +70,7 @@ public:
 		d = NULL;
 		num = 0;
 	};
-	void Allocate(int nt)
+	void Allocate(SRindex nt)
 	{
 		if(nt == 0)
 			return;
@@ -68,52 +81,52 @@ public:
 		Zero();
 	};
 	void PushBack(int v);
-	void Zero(int nt = 0)
+	void Zero(SRindex nt = 0)
 	{
-		int n;
+		SRindex n;
 		if(nt == 0)
 			n = num;
 		else
             n = nt;
-		for(int i = 0; i < n; i++)
+		for(SRindex i = 0; i < n; i++)
 			d[i] = 0;
 	};
 	void Set(int i)
 	{
-		for (int i = 0; i < num; i++)
+		for (SRindex i = 0; i < num; i++)
 			d[i] = i;
 	};
-	void Copy(SRintVector& v2, int numt = 0)
+	void Copy(SRintVector& v2, SRindex numt = 0)
 	{
-		int len;
+		SRindex len;
 		if(numt == 0)
 			len = v2.GetNum();
 		else
 			len = numt;
 		if(num < len)
 			Allocate(len);
-		for(int i = 0; i < len; i++)
+		for(SRindex i = 0; i < len; i++)
 			d[i] = v2.d[i];
 	};
 	int* GetVector(){ return d; };
 #ifdef _DEBUG
-	inline int Get(int i){ return d[i]; };
+	inline int Get(SRindex i){ return d[i]; };
 #else
-	inline int Get(int i){ return d[i];};
+	inline int Get(SRindex i){ return d[i];};
 #endif
 #ifdef _DEBUG
-	inline void Put(int i, int di){ d[i] = di; };
+	inline void Put(SRindex i, int di){ d[i] = di; };
 #else
-	inline void Put(int i,int di){ d[i] = di; };
+	inline void Put(SRindex i,int di){ d[i] = di; };
 #endif
 #ifdef _DEBUG
-	inline void PlusAssign(int i, int di){ d[i] += di; };
+	inline void PlusAssign(SRindex i, int di){ d[i] += di; };
 #else
-	inline void PlusAssign(int i, int di){ d[i] += di; };
+	inline void PlusAssign(SRindex i, int di){ d[i] += di; };
 #endif
-	int operator [] (int i) { return Get(i); };
+	int operator [] (SRindex i) { return Get(i); };
 
-	SRintVector(int nt){ Allocate(nt); };
+	SRintVector(SRindex nt){ Allocate(nt); };
 	SRintVector(){ num = 0; d = NULL; };
 	~SRintVector()
     {
@@ -121,7 +134,65 @@ public:
 	};
 
 	int* d;
-	int num;
+	SRindex num;
+};
+
+//compact set of non-negative integers such as node uids, 1 bit per possible value.
+//grows as needed so it can be filled without knowing the largest value in advance
+class SRbitVector
+{
+public:
+	bool isEmpty(){ return (d.size() == 0); };
+	void Free(){ d.clear(); };
+	void Set(int i)
+	{
+		if (i < 0)
+			return;
+		int w = i >> 5;
+		if (w >= (int) d.size())
+			d.resize(w + w / 2 + 1, 0);
+		d[w] |= (1u << (i & 31));
+	};
+	bool Get(int i)
+	{
+		if (i < 0)
+			return false;
+		int w = i >> 5;
+		if (w >= (int) d.size())
+			return false;
+		return ((d[w] >> (i & 31)) & 1u) != 0;
+	};
+	SRindex Count()
+	{
+		//number of values in the set
+		SRindex n = 0;
+		for (int w = 0; w < (int) d.size(); w++)
+			n += CountBits(d[w]);
+		return n;
+	};
+	SRindex CountCommon(SRbitVector& that)
+	{
+		//number of values that are in this set and in "that"
+		SRindex n = 0;
+		int nw = d.size();
+		if ((int) that.d.size() < nw)
+			nw = that.d.size();
+		for (int w = 0; w < nw; w++)
+			n += CountBits(d[w] & that.d[w]);
+		return n;
+	};
+	static int CountBits(unsigned v)
+	{
+		int n = 0;
+		while (v != 0)
+		{
+			v &= (v - 1);
+			n++;
+		}
+		return n;
+	};
+
+	vector <unsigned> d;
 };
 
 class SRdoubleVector
@@ -129,7 +200,7 @@ class SRdoubleVector
 public:
 	bool isEmpty(){ return (d == NULL); };
 	void EquateVector(double* v){ d = v; };
-	int GetNum(){ return num; };
+	SRindex GetNum(){ return num; };
 	void Copy(SRdoubleVector& v2){ Copy(v2.d, v2.GetNum()); };
 	void PushBack(double v);
 	void Free()
@@ -140,7 +211,7 @@ public:
 		d = NULL;
 		num = 0;
 	};
-	void Allocate(int nt)
+	void Allocate(SRindex nt)
 	{
 		if(nt == 0)
 			return;
@@ -150,40 +221,40 @@ public:
 		d = ALLOCATEMEMORY double[num];
 		Zero();
 	};
-	void Zero(int nt = 0)
+	void Zero(SRindex nt = 0)
 	{
-		int n;
+		SRindex n;
 		if(nt == 0)
 			n = num;
 		else
 			n = nt;
-		for(int i = 0; i < n; i++)
+		for(SRindex i = 0; i < n; i++)
 			d[i] = 0.0;
 	};
 	void Set(double s)
 	{
-		for (int i = 0; i < num; i++)
+		for (SRindex i = 0; i < num; i++)
 			d[i] = s;
 	};
-	void Copy(double* v2, int len)
+	void Copy(double* v2, SRindex len)
 	{
 		if(num < len)
 			Allocate(len);
-		for(int i = 0; i < len; i++)
+		for(SRindex i = 0; i < len; i++)
 			d[i] = v2[i];
 	};
 	double* GetVector(){ return d; };
-	inline double Get(int i){ return d[i]; };
-	inline void Put(int i, double di){ d[i] = di; };
-	inline void PlusAssign(int i, double di){ d[i] += di; };
-	double operator [] (int i) { return Get(i); };
+	inline double Get(SRindex i){ return d[i]; };
+	inline void Put(SRindex i, double di){ d[i] = di; };
+	inline void PlusAssign(SRindex i, double di){ d[i] += di; };
+	double operator [] (SRindex i) { return Get(i); };
 
-	SRdoubleVector(int nt){ Allocate(nt); };
+	SRdoubleVector(SRindex nt){ Allocate(nt); };
 	SRdoubleVector(){ num = 0; d = NULL; };
 	~SRdoubleVector(){ Free(); };
 
 	double* d;
-	int num;
+	SRindex num;
 };
 
 template <class gen>
@@ -196,19 +267,19 @@ public:
 		if (!isEmpty())
 			d.clear();
 	};
-	void Allocate(int nt)
+	void Allocate(SRindex nt)
 	{
 		d.resize(nt);
 	};
-	int GetNum(){ return d.size(); };
-	inline gen* GetVector(){ return &d[0]; };
-	inline gen *GetPointer(int i){ return &d[i]; };
-	gen& Get(int i){ return d[i]; };
-	inline void Put(int i, gen &di){ d[i] = di; };
-	inline void PlusAssign(int i, gen &di){ d[i] += di; };
+	SRindex GetNum(){ return d.size(); };
+	inline gen* GetVector(){ return d.data(); };
+	inline gen *GetPointer(SRindex i){ return &d[i]; };
+	gen& Get(SRindex i){ return d[i]; };
+	inline void Put(SRindex i, gen &di){ d[i] = di; };
+	inline void PlusAssign(SRindex i, gen &di){ d[i] += di; };
 	void pushBack(gen dt){ d.push_back(dt); };
-	gen operator [] (int i) { return Get(i); };
-	SRvector(int nt){ d.resize(0); Allocate(nt); };
+	gen operator [] (SRindex i) { return Get(i); };
+	SRvector(SRindex nt){ d.resize(0); Allocate(nt); };
 	SRvector(){ d.resize(0); };
 	~SRvector(){ Free(); };
 	vector <gen> d;
@@ -217,6 +288,13 @@ public:
 //use SRpointerVector instead of SRvector for cases like faces where 
 //have to conservatively allocate because only some extra pointers are wasted,
 //not storage of extra structure
+//entities are constructed in place in large contiguous blocks, so Add is amortized constant
+//time, never overruns, and entities added in sequence are adjacent in memory.
+//the pointer index is kept so entities never move: pointers to them stay valid,
+//and they can be freed one at a time and packed (Free(i), packNulls). a block is released
+//as soon as every entity in it has been freed
+
+#define POINTERVECTORMINBLOCK 16
 
 template <class gen>
 class SRpointerVector
@@ -226,93 +304,155 @@ public:
 
 	void ClearButNotFree()
 	{
-		if (isEmpty())
-			return;
-		for (int i = 0; i < num; i++)
-			DELETEMEMORY d[i];
+		//destroy all entities but keep the storage that has not been released for reuse
+		destroyAll();
+		d.clear();
+		slotBlock.clear();
 		num = 0;
+		int nkept = 0;
+		for (int b = 0; b < (int) blocks.size(); b++)
+		{
+			if (blocks[b] == NULL)
+				continue;
+			blocks[nkept] = blocks[b];
+			blockCaps[nkept] = blockCaps[b];
+			blockLive[nkept] = 0;
+			nkept++;
+		}
+		blocks.resize(nkept);
+		blockCaps.resize(nkept);
+		blockLive.resize(nkept);
+		curBlock = 0;
+		blockUsed = 0;
 	};
 
 	void Free()
 	{
-		if (isEmpty())
-			return;
-		for (int i = 0; i < num; i++)
-			DELETEMEMORY d[i];
-		d.clear();
+		destroyAll();
+		vector <gen *>().swap(d);
+		vector <int>().swap(slotBlock);
 		num = 0;
-	};
-	void Free(int i)
-	{
-		DELETEMEMORY d[i];
+		for (int b = 0; b < (int) blocks.size(); b++)
+			::operator delete(blocks[b]);
+		blocks.clear();
+		blockCaps.clear();
+		blockLive.clear();
+		curBlock = 0;
+		blockUsed = 0;
+	};
+	void Free(SRindex i)
+	{
+		//destroy entity i. its slot stays NULL until packNulls is called.
+		//the block it was in is released when it was the last live entity in it
+		if (d[i] == NULL)
+			return;
+		d[i]->~gen();
 		d[i] = NULL;
+		int b = slotBlock[i];
+		blockLive[b]--;
+		if (blockLive[b] == 0)
+		{
+			::operator delete(blocks[b]);
+			blocks[b] = NULL;
+			//a released block counts as full, so Add and Allocate move on to the next one:
+			if (b == curBlock)
+				blockCaps[b] = blockUsed;
+		}
 	};
 
-	void Allocate(int nt)
+	void Allocate(SRindex nt)
 	{
-		if (nt == 0)
+		//reserve room for nt entities in total. not required before Add, but
+		//allocating the expected number up front puts them in a single block
+		if (nt <= num)
 			return;
-		d.resize(nt);
-	};
-
-	int GetNum(){ return num; };
-	int GetLength(){ return d.size(); };
+		d.reserve(nt);
+		SRindex nfree = 0;
+		for (int b = curBlock; b < (int) blocks.size(); b++)
+			nfree += blockCaps[b];
+		if (curBlock < (int) blocks.size())
+			nfree -= blockUsed;
+		if (nfree < nt - num)
+			addBlock(nt - num - nfree);
+	};
+
+	SRindex GetNum(){ return num; };
+	SRindex GetLength(){ return d.capacity(); };
 	gen* Add()
 	{
-		if (d[num] == NULL)
-			d[num] = ALLOCATEMEMORY gen();
+		while (curBlock < (int) blocks.size() && blockUsed == blockCaps[curBlock])
+		{
+			curBlock++;
+			blockUsed = 0;
+		}
+		if (curBlock == (int) blocks.size())
+		{
+			//grow geometrically:
+			SRindex nt = num / 2;
+			if (nt < POINTERVECTORMINBLOCK)
+				nt = POINTERVECTORMINBLOCK;
+			addBlock(nt);
+		}
+		gen* g = new (blocks[curBlock] + blockUsed) gen();
+		blockUsed++;
+		blockLive[curBlock]++;
+		d.push_back(g);
+		slotBlock.push_back(curBlock);
 		num++;
-		return d[num - 1];
+		return g;
 	};
 #ifdef _DEBUG
-	inline gen *GetPointer(int i){ return d[i]; };
+	inline gen *GetPointer(SRindex i){ return d[i]; };
 #else
-	inline gen *GetPointer(int i){ return d[i]; };
+	inline gen *GetPointer(SRindex i){ return d[i]; };
 #endif
 
 	void packNulls()
 	{
-		int npacked = 0;
-		int i = 0;
-		while (1)
+		SRindex npacked = 0;
+		for (SRindex i = 0; i < num; i++)
 		{
-			if (i >= num)
-				break;
 			if (d[i] != NULL)
 			{
 				d[npacked] = d[i];
+				slotBlock[npacked] = slotBlock[i];
 				npacked++;
-				i++;
-				continue;
-			}
-			while (1)
-			{
-				if (i >= num)
-					break;
-				if (d[i] == NULL)
-				{
-					i++;
-					continue;
-				}
-				d[npacked] = d[i];
-				npacked++;
-				i++;
-				break;
 			}
 		}
-		if (npacked < num)
-		{
-			num = npacked;
-			d.resize(num);
-		}
-
+		num = npacked;
+		d.resize(num);
+		slotBlock.resize(num);
 	};
 
 
-	SRpointerVector(){ num = 0; d.resize(0); };
+	SRpointerVector(){ num = 0; curBlock = 0; blockUsed = 0; };
 	~SRpointerVector(){ Free(); };
 	vector <gen *> d;
-	int num;
+	SRindex num;
+
+private:
+	SRpointerVector(const SRpointerVector&) = delete;
+	SRpointerVector& operator=(const SRpointerVector&) = delete;
+	void addBlock(SRindex nt)
+	{
+		blocks.push_back((gen*) ::operator new(nt * sizeof(gen)));
+		blockCaps.push_back(nt);
+		blockLive.push_back(0);
+	};
+	void destroyAll()
+	{
+		for (SRindex i = 0; i < num; i++)
+		{
+			if (d[i] != NULL)
+				d[i]->~gen();
+		}
+	};
+	vector <gen *> blocks; //storage for the entities, NULL once released by Free(i)
+	vector <SRindex> blockCaps; //number of entities that fit in each block
+	vector <SRindex> blockLive; //number of entities in each block that have not been freed
+	vector <int> slotBlock; //block of the entity in each slot of d
+	int curBlock; //block being filled
+	SRindex blockUsed; //number of entities constructed in curBlock
 };
 
 class SRintMatrix
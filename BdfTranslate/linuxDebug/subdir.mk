@@ -19,6 +19,7 @@ CPP_SRCS += \
 ../SRmodel.cpp \
 ../SRnode.cpp \
 ../SRoutput.cpp \
+../SRparallel.cpp \
 ../SRstring.cpp \
 ../SRutil.cpp 
 
@@ -38,6 +39,7 @@ OBJS += \
 ./SRmodel.o \
 ./SRnode.o \
 ./SRoutput.o \
+./SRparallel.o \
 ./SRstring.o \
 ./SRutil.o 
 
@@ -57,6 +59,7 @@ CPP_DEPS += \
 ./SRmodel.d \
 ./SRnode.d \
 ./SRoutput.d \
+./SRparallel.d \
 ./SRstring.d \
 ./SRutil.d 
 
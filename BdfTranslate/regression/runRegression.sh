@@ -0,0 +1,148 @@
+#!/bin/sh
+# runRegression.sh: translate each deck of the regression corpus with bdfTranslate --golden and
+# fail if any output differs from its golden files or the throughput has fallen too far
+#
+# usage: runRegression.sh [--update] [--nothroughput] [bdfTranslate]
+	#--update = replace the golden files with the output of this translation instead of comparing
+	#--nothroughput = skip the throughput check, e.g. for a debug build
+	#bdfTranslate = executable to test, default ../linuxRelease/bdfTranslate next to this directory
+#each deck is a directory <name> holding:
+	#<name>.bdf = the deck
+	#disp.csv = optional. displacement file, the model is cropped to its nodes
+	#option.txt = optional. the third line of translateCmd.txt, e.g. "breakout box ..."
+	#golden = the golden .msh, .srr, subcase .loads files and xlate_status.txt, see checkGolden in BdfTranslate.cpp
+#the throughput of these small decks is noise, so their golden throughput.txt files have tolerance 1, which
+#turns that check off. the throughput is checked on a deck too large to keep in the corpus:
+	#throughput/makeDeck.awk generates it. it is translated once to make its golden files, which also
+	#warms the file cache, then again with --golden against them and throughput/throughput.txt,
+	#"<MB/s> <tolerance>". a timing is noisy, so a run that fails only on throughput is tried up to
+	#THROUGHPUTTRIES times. --update sets the golden MB/s to the median of THROUGHPUTTRIES runs.
+	#the golden MB/s is for the release build on the machine that last updated it
+#exit status is 0 if every deck passes, else 1. the work directories of failed decks are kept
+
+THROUGHPUTELEMS=50 #elements per side of the generated deck, about 19 MB of bdf
+THROUGHPUTTOL=0.25 #default tolerance of the golden throughput, as GOLDENTOLERANCE in BdfTranslate.cpp
+THROUGHPUTTRIES=3
+
+here=$(cd "$(dirname "$0")" && pwd)
+update=0
+throughput=1
+while [ $# -gt 0 ]; do
+	case "$1" in
+	--update) update=1 ;;
+	--nothroughput) throughput=0 ;;
+	*) break ;;
+	esac
+	shift
+done
+exe=${1:-$here/../linuxRelease/bdfTranslate}
+exe=$(cd "$(dirname "$exe")" && pwd)/$(basename "$exe")
+if [ ! -x "$exe" ]; then
+	echo "runRegression: $exe not found"
+	exit 1
+fi
+
+tmp=$(mktemp -d "${TMPDIR:-/tmp}/bdfRegression.XXXXXX")
+nfail=0
+
+#makeWorkDir <work dir> <bdf file> <model name> [third line]: work directory with its translateCmd.txt
+makeWorkDir()
+{
+	mkdir -p "$1/out"
+	{
+		echo "$2"
+		echo "$1/out/$3"
+		[ -n "$4" ] && echo "$4"
+	} > "$1/translateCmd.txt"
+}
+
+#translate <work dir> <golden option> <golden dir>: run bdfTranslate, output in <work dir>/screen.txt
+translate()
+{
+	(cd "$1" && "$exe" "$2" "$3" "$1/" > screen.txt 2>&1)
+}
+
+for deck in "$here"/*/; do
+	name=$(basename "$deck")
+	deck=$here/$name
+	[ -f "$deck/$name.bdf" ] || continue
+	wk=$tmp/$name
+	third=
+	if [ -f "$deck/disp.csv" ]; then
+		third=$deck/disp.csv
+	elif [ -f "$deck/option.txt" ]; then
+		third=$(head -n 1 "$deck/option.txt")
+	fi
+	makeWorkDir "$wk" "$deck/$name.bdf" "$name" "$third"
+	if [ $update -eq 1 ]; then
+		translate "$wk" --golden-update "$deck/golden"
+		rc=$?
+		pass="golden files updated"
+	else
+		translate "$wk" --golden "$deck/golden"
+		rc=$?
+		pass="golden check passed"
+	fi
+	#an error exit of the translator may return 0, so the golden check must also have reported:
+	if [ $rc -eq 0 ] && grep -q "$pass" "$wk/screen.txt"; then
+		if [ $update -eq 1 ]; then
+			mbps=$(cut -d " " -f 1 "$deck/golden/throughput.txt")
+			echo "$mbps 1.00" > "$deck/golden/throughput.txt"
+		fi
+		echo "pass  $name"
+		rm -rf "$wk"
+	else
+		echo "FAIL  $name (exit $rc), see $wk"
+		grep "golden check" "$wk/screen.txt"
+		nfail=$((nfail + 1))
+	fi
+done
+
+if [ $throughput -eq 1 ]; then
+	wk=$tmp/throughput
+	mkdir -p "$wk"
+	awk -v n=$THROUGHPUTELEMS -f "$here/throughput/makeDeck.awk" > "$wk/throughput.bdf"
+	makeWorkDir "$wk" "$wk/throughput.bdf" throughput
+	translate "$wk" --golden-update "$wk/golden"
+	ok=0
+	if [ $update -eq 1 ]; then
+		runs=
+		for i in $(seq $THROUGHPUTTRIES); do
+			translate "$wk" --golden-update "$wk/golden" || break
+			runs="$runs $(cut -d " " -f 1 "$wk/golden/throughput.txt")"
+		done
+		mbps=$(echo $runs | tr " " "\n" | sort -n | sed -n "$(( (THROUGHPUTTRIES + 1) / 2 ))p")
+		if [ -n "$mbps" ]; then
+			echo "$mbps $THROUGHPUTTOL" > "$here/throughput/throughput.txt"
+			ok=1
+		fi
+	else
+		for i in $(seq $THROUGHPUTTRIES); do
+			cp "$here/throughput/throughput.txt" "$wk/golden/throughput.txt"
+			translate "$wk" --golden "$wk/golden"
+			rc=$?
+			if [ $rc -eq 0 ] && grep -q "golden check passed" "$wk/screen.txt"; then
+				ok=1
+				break
+			fi
+			#only a throughput failure is worth another try:
+			grep "golden check" "$wk/screen.txt" | grep -v -q "throughput" && break
+		done
+	fi
+	if [ $ok -eq 1 ]; then
+		echo "pass  throughput ($(grep -o "[0-9.]* MB/s" "$wk/screen.txt" | head -n 1), golden $(cat "$here/throughput/throughput.txt"))"
+		rm -rf "$wk"
+	else
+		echo "FAIL  throughput, see $wk"
+		grep "golden check" "$wk/screen.txt"
+		nfail=$((nfail + 1))
+	fi
+fi
+
+if [ $nfail -ne 0 ]; then
+	echo "runRegression: $nfail deck(s) failed"
+	exit 1
+fi
+rmdir "$tmp"
+echo "runRegression: all decks passed"
+exit 0
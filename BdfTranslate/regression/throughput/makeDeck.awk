@@ -0,0 +1,47 @@
+# makeDeck.awk: write a small field bdf deck of an n x n x n block of CHEXA elements on a unit cube,
+# for the throughput check of runRegression.sh
+#
+# usage: awk -v n=<elements per side> -f makeDeck.awk > deck.bdf
+	#the bottom face is clamped with SPC1 cards and the top face nodes are loaded with FORCE cards.
+	#the output is the same for the same n, so the translation can be compared between runs
+
+function nid(i, j, k)
+{
+	return 1 + i + (n + 1) * (j + (n + 1) * k)
+}
+
+BEGIN {
+	if (n < 1)
+		n = 50
+	h = 1.0 / n
+	print "SOL 101"
+	print "CEND"
+	print "SUBCASE 1"
+	print " LOAD = 1"
+	print " SPC = 1"
+	print "BEGIN BULK"
+	print "$ Femap with NX Nastran Material 1 : STEEL"
+	print "MAT1    1       2.+11           .3      7800.   1.2-5   20."
+	print "PSOLID  1       1       0"
+	for (k = 0; k <= n; k++)
+		for (j = 0; j <= n; j++)
+			for (i = 0; i <= n; i++)
+				printf "GRID    %-8d        %-8.5f%-8.5f%-8.5f\n", nid(i, j, k), i * h, j * h, k * h
+	e = 1
+	for (k = 0; k < n; k++)
+		for (j = 0; j < n; j++)
+			for (i = 0; i < n; i++)
+			{
+				printf "CHEXA   %-8d1       %-8d%-8d%-8d%-8d%-8d%-8d+\n", e, nid(i, j, k), nid(i + 1, j, k),
+					nid(i + 1, j + 1, k), nid(i, j + 1, k), nid(i, j, k + 1), nid(i + 1, j, k + 1)
+				printf "+       %-8d%-8d\n", nid(i + 1, j + 1, k + 1), nid(i, j + 1, k + 1)
+				e++
+			}
+	for (j = 0; j <= n; j++)
+		for (i = 0; i <= n; i++)
+		{
+			printf "SPC1    1       123     %-8d\n", nid(i, j, 0)
+			printf "FORCE   1       %-8d0       10.     0.      0.      -1.\n", nid(i, j, n)
+		}
+	print "ENDDATA"
+}